@@ -0,0 +1,495 @@
+/*!
+ *  \brief     Cooperative multi-agent planner impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_agents.h"
+#include "u_expand.h"
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <deque>
+#include <unordered_set>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// distance to goal which can not be reached
+constexpr FLOAT UNREACHABLE = numeric_limits<FLOAT>::max();
+
+// no parent, no owner
+constexpr DWORD NONE = MAXDWORD;
+
+// one step of waiting outside of goal costs as one straight step on plains
+constexpr FLOAT WAIT_COST = 1.0f;
+
+// wait is the move after all directions
+constexpr BYTE WAIT_MOVE = NEIGHBOURS_COUNT;
+
+// straight and diagonal move multipliers, same as AStar uses
+const FLOAT MOVE_WEIGHTS[NEIGHBOURS_COUNT] = { 1.0f, 1.0f, 1.0f, 1.0f,
+  sqrtf(2.0f), sqrtf(2.0f), sqrtf(2.0f), sqrtf(2.0f) };
+
+/************************************************
+ *  CooperativePlanner class impl
+ ***********************************************/
+
+CooperativePlanner::CooperativePlanner(const World& world, WORD window, size_t maxSteps)
+  : m_Cols(world.GetCols()), m_Rows(world.GetRows()), m_Window(window), m_MaxSteps(maxSteps),
+  m_Cooperative(true), m_Rounds(0), m_Conflicts(0), m_Duration(0)
+{
+  if (window == 0 || window > MAXBYTE)
+  {
+    throw runtime_error("Window is out of range");
+  }
+
+  if (!m_MaxSteps) m_MaxSteps = 4 * (m_Cols + m_Rows);
+
+  const auto* costs = world.GetPaddedCosts();
+  m_Costs.resize(m_Cols * m_Rows);
+
+  for (size_t y = 0; y < m_Rows; y++)
+  {
+    for (size_t x = 0; x < m_Cols; x++)
+    {
+      m_Costs[y * m_Cols + x] = costs[world.GetPaddedIndex(static_cast<WORD>(x), static_cast<WORD>(y))];
+    }
+  }
+
+  m_Path.resize(static_cast<size_t>(m_Window) + 1);
+}
+
+size_t CooperativePlanner::Plan(const std::vector<AgentRequest>& agents)
+{
+  auto start = high_resolution_clock::now();
+
+  for (const auto& agent : agents)
+  {
+    if (agent.Start.X >= m_Cols || agent.Start.Y >= m_Rows || agent.Goal.X >= m_Cols || agent.Goal.Y >= m_Rows)
+    {
+      throw runtime_error("Agent position is out of map");
+    }
+  }
+
+  // agent which can not move keeps its start cell, two of them there would release each other forever
+  unordered_set<DWORD> starts;
+
+  for (const auto& agent : agents)
+  {
+    if (!starts.insert(static_cast<DWORD>(agent.Start.Y * m_Cols + agent.Start.X)).second)
+    {
+      throw runtime_error("Agents share start cell");
+    }
+  }
+
+  m_Plans.assign(agents.size(), {});
+  m_Distances.assign(agents.size(), {});
+  m_Rounds = 0;
+  m_Conflicts = 0;
+
+  vector<DWORD> current(agents.size());
+  vector<vector<DWORD>> windows(agents.size());
+  vector<BYTE> stranded(agents.size(), false);
+
+  // planning order, agent which did not move in a round goes first in the next
+  vector<DWORD> order(agents.size());
+  for (size_t i = 0; i < agents.size(); i++) order[i] = static_cast<DWORD>(i);
+
+  for (size_t i = 0; i < agents.size(); i++)
+  {
+    current[i] = static_cast<DWORD>(agents[i].Start.Y * m_Cols + agents[i].Start.X);
+
+    auto& distance = m_Distances[i];
+    distance.Goal = static_cast<DWORD>(agents[i].Goal.Y * m_Cols + agents[i].Goal.X);
+    distance.Target = current[i];
+
+    // water goal is never reached, open list stays empty then
+    if (m_Costs[distance.Goal] > 0.0f)
+    {
+      distance.Cells[distance.Goal] = { 0.0f, false };
+      distance.Open.push_back({ 0.0f, 0.0f, distance.Goal });
+    }
+
+    m_Plans[i].Steps.push_back(agents[i].Start);
+
+    // batch does not wait for agents which can never reach their goals
+    stranded[i] = m_Costs[current[i]] <= 0.0f || GetTrueDistance(distance, current[i], m_Plans[i].Expansions) == UNREACHABLE;
+  }
+
+  // agents go half of window, the rest was only a look ahead
+  const size_t advance = max<size_t>(m_Window / 2, 1);
+
+  for (size_t time = 0; time < m_MaxSteps; time += advance, m_Rounds++)
+  {
+    BOOL done = true;
+    for (size_t i = 0; done && i < agents.size(); i++) done = stranded[i] || current[i] == m_Distances[i].Goal;
+
+    if (done) break;
+
+    m_Reserved.clear();
+
+    // agents stand where they are, nobody may swap with them in the first step
+    if (m_Cooperative)
+    {
+      for (size_t i = 0; i < agents.size(); i++) m_Reserved.try_emplace(GetKey(current[i], time), static_cast<DWORD>(i));
+    }
+
+    // releases window of agent, it is planned again
+    auto release = [&](DWORD agent)
+    {
+      for (size_t step = 1; step < windows[agent].size(); step++)
+      {
+        auto key = GetKey(windows[agent][step], time + step);
+        auto found = m_Reserved.find(key);
+        if (found != m_Reserved.end() && found->second == agent) m_Reserved.erase(found);
+      }
+
+      windows[agent].clear();
+    };
+
+    deque<DWORD> pending(order.begin(), order.end());
+
+    while (!pending.empty())
+    {
+      auto i = pending.front();
+      pending.pop_front();
+
+      auto agentStart = high_resolution_clock::now();
+
+      auto planned = PlanWindow(i, current[i], time);
+
+      if (m_Cooperative)
+      {
+        // agent which can not move stays for the whole window, so agents
+        // which reserved its cell go around it, they are planned again
+        if (!planned)
+        {
+          for (size_t step = 1; step < m_Path.size(); step++)
+          {
+            auto owner = GetOwner(current[i], time + step);
+            if (owner == NONE || owner == i) continue;
+
+            release(owner);
+            pending.push_front(owner);
+          }
+        }
+
+        for (size_t step = 1; step < m_Path.size(); step++) m_Reserved.try_emplace(GetKey(m_Path[step], time + step), i);
+      }
+
+      windows[i].assign(m_Path.begin(), m_Path.end());
+
+      auto agentEnd = high_resolution_clock::now();
+      m_Plans[i].Duration += duration_cast<microseconds>(agentEnd - agentStart).count() / 1000.0;
+    }
+
+    vector<BYTE> stuck(agents.size(), false);
+
+    for (size_t i = 0; i < agents.size(); i++)
+    {
+      for (size_t step = 1; step <= advance && step < windows[i].size(); step++)
+      {
+        m_Plans[i].Steps.push_back(GetPosition(windows[i][step]));
+      }
+
+      auto next = windows[i][min(advance, windows[i].size() - 1)];
+      stuck[i] = next == current[i] && next != m_Distances[i].Goal && !stranded[i];
+      current[i] = next;
+    }
+
+    stable_partition(order.begin(), order.end(), [&stuck](DWORD agent) { return stuck[agent]; });
+  }
+
+  size_t reached = 0;
+
+  for (size_t i = 0; i < agents.size(); i++)
+  {
+    auto& plan = m_Plans[i];
+    auto goal = m_Distances[i].Goal;
+
+    // agent stays at the last position, waits at the end are not kept
+    while (plan.Steps.size() > 1 && plan.Steps[plan.Steps.size() - 1].X == plan.Steps[plan.Steps.size() - 2].X &&
+      plan.Steps[plan.Steps.size() - 1].Y == plan.Steps[plan.Steps.size() - 2].Y)
+    {
+      plan.Steps.pop_back();
+    }
+
+    for (size_t step = 1; step < plan.Steps.size(); step++)
+    {
+      const auto& from = plan.Steps[step - 1];
+      const auto& to = plan.Steps[step];
+      auto cell = static_cast<DWORD>(to.Y * m_Cols + to.X);
+
+      if (from.X == to.X && from.Y == to.Y)
+      {
+        if (cell != goal) plan.Cost += WAIT_COST;
+        continue;
+      }
+
+      auto diagonal = from.X != to.X && from.Y != to.Y;
+      plan.Cost += MOVE_WEIGHTS[diagonal ? NEIGHBOURS_COUNT - 1 : 0] * m_Costs[cell];
+    }
+
+    plan.Reached = plan.Steps.back().Y * m_Cols + plan.Steps.back().X == goal;
+    if (plan.Reached) reached++;
+  }
+
+  // backward searches of agents are not needed after batch
+  m_Distances.clear();
+
+  m_Conflicts = CountConflicts(m_Plans);
+
+  auto end = high_resolution_clock::now();
+  m_Duration = duration_cast<microseconds>(end - start).count() / 1000.0;
+
+  return reached;
+}
+
+FLOAT CooperativePlanner::GetTrueDistance(TrueDistance& distance, DWORD cell, size_t& expansions)
+{
+  auto found = distance.Cells.find(cell);
+  if (found != distance.Cells.end() && found->second.Closed) return found->second.G;
+
+  const INT targetX = static_cast<INT>(distance.Target % m_Cols);
+  const INT targetY = static_cast<INT>(distance.Target / m_Cols);
+
+  // octile distance to where agent started, plains are the cheapest terrain
+  auto heuristic = [&](INT x, INT y)
+  {
+    auto dx = static_cast<FLOAT>(abs(x - targetX));
+    auto dy = static_cast<FLOAT>(abs(y - targetY));
+    return max(dx, dy) + (MOVE_WEIGHTS[NEIGHBOURS_COUNT - 1] - 1.0f) * min(dx, dy);
+  };
+
+  while (!distance.Open.empty())
+  {
+    pop_heap(distance.Open.begin(), distance.Open.end());
+    auto current = distance.Open.back();
+    distance.Open.pop_back();
+
+    auto& currentCell = distance.Cells[current.Item];
+    if (currentCell.Closed || current.G > currentCell.G) continue;
+
+    currentCell.Closed = true;
+    expansions++;
+
+    INT x = static_cast<INT>(current.Item % m_Cols);
+    INT y = static_cast<INT>(current.Item / m_Cols);
+
+    // going backward, step from neighbour into current costs terrain of current
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      INT nx = x + DIRECTION_DX[i];
+      INT ny = y + DIRECTION_DY[i];
+
+      if (nx < 0 || ny < 0 || nx >= static_cast<INT>(m_Cols) || ny >= static_cast<INT>(m_Rows)) continue;
+
+      auto neighbour = static_cast<DWORD>(ny * m_Cols + nx);
+      if (m_Costs[neighbour] <= 0.0f) continue;
+
+      auto g = current.G + MOVE_WEIGHTS[i] * m_Costs[current.Item];
+      auto& neighbourCell = distance.Cells.try_emplace(neighbour, DistanceCell{ UNREACHABLE, false }).first->second;
+
+      if (neighbourCell.Closed || g >= neighbourCell.G) continue;
+
+      neighbourCell.G = g;
+      distance.Open.push_back({ g + heuristic(nx, ny), g, neighbour });
+      push_heap(distance.Open.begin(), distance.Open.end());
+    }
+
+    if (current.Item == cell) return current.G;
+  }
+
+  return UNREACHABLE;
+}
+
+BOOL CooperativePlanner::PlanWindow(DWORD agent, DWORD cell, size_t time)
+{
+  auto& plan = m_Plans[agent];
+  auto& distance = m_Distances[agent];
+  const auto goal = distance.Goal;
+
+  // agent stays if nothing better is found
+  fill(m_Path.begin(), m_Path.end(), cell);
+
+  if (m_Costs[cell] <= 0.0f) return false;
+
+  auto h = GetTrueDistance(distance, cell, plan.Expansions);
+  if (h == UNREACHABLE) return false;
+
+  m_Nodes.clear();
+  m_Open.clear();
+  m_Visited.clear();
+
+  m_Nodes.push_back({ 0.0f, cell, NONE, 0 });
+  m_Open.push_back({ h, 0.0f, 0 });
+
+  DWORD best = NONE;
+
+  while (!m_Open.empty())
+  {
+    pop_heap(m_Open.begin(), m_Open.end());
+    auto index = m_Open.back().Item;
+    m_Open.pop_back();
+
+    auto node = m_Nodes[index];
+
+    // outdated entry, this cell at this step was reached cheaper
+    auto visited = m_Visited.find(GetKey(node.Cell, node.Step));
+    if (visited != m_Visited.end() && visited->second < node.G) continue;
+
+    // window is planned, or agent may rest at goal till its end
+    if (node.Step == m_Window || (node.Cell == goal && IsFreeUntil(agent, goal, time + node.Step + 1, time + m_Window)))
+    {
+      best = index;
+      break;
+    }
+
+    plan.Expansions++;
+
+    INT x = static_cast<INT>(node.Cell % m_Cols);
+    INT y = static_cast<INT>(node.Cell / m_Cols);
+    auto step = static_cast<WORD>(node.Step + 1);
+
+    for (BYTE i = 0; i <= WAIT_MOVE; i++)
+    {
+      auto next = node.Cell;
+
+      if (i != WAIT_MOVE)
+      {
+        INT nx = x + DIRECTION_DX[i];
+        INT ny = y + DIRECTION_DY[i];
+
+        if (nx < 0 || ny < 0 || nx >= static_cast<INT>(m_Cols) || ny >= static_cast<INT>(m_Rows)) continue;
+
+        next = static_cast<DWORD>(ny * m_Cols + nx);
+        if (m_Costs[next] <= 0.0f) continue;
+      }
+
+      if (m_Cooperative)
+      {
+        // cell is taken, or agent standing there comes into our cell meanwhile
+        auto owner = GetOwner(next, time + step);
+        auto swapper = i == WAIT_MOVE ? NONE : GetOwner(next, time + node.Step);
+
+        if ((owner != NONE && owner != agent) ||
+          (swapper != NONE && swapper != agent && GetOwner(node.Cell, time + step) == swapper))
+        {
+          plan.Blocked++;
+          continue;
+        }
+      }
+
+      auto g = node.G;
+      if (i != WAIT_MOVE) g += MOVE_WEIGHTS[i] * m_Costs[next];
+      else if (next != goal) g += WAIT_COST;
+
+      auto key = GetKey(next, step);
+      visited = m_Visited.find(key);
+      if (visited != m_Visited.end() && visited->second <= g) continue;
+
+      auto nextH = GetTrueDistance(distance, next, plan.Expansions);
+      if (nextH == UNREACHABLE) continue;
+
+      m_Visited[key] = g;
+      m_Nodes.push_back({ g, next, index, step });
+      m_Open.push_back({ g + nextH, g, static_cast<DWORD>(m_Nodes.size() - 1) });
+      push_heap(m_Open.begin(), m_Open.end());
+    }
+  }
+
+  if (best == NONE) return false;
+
+  // agent rests at the last cell till window end
+  fill(m_Path.begin() + m_Nodes[best].Step, m_Path.end(), m_Nodes[best].Cell);
+
+  for (auto index = best; index != NONE; index = m_Nodes[index].Parent)
+  {
+    m_Path[m_Nodes[index].Step] = m_Nodes[index].Cell;
+  }
+
+  return true;
+}
+
+BOOL CooperativePlanner::IsFreeUntil(DWORD agent, DWORD cell, size_t from, size_t to) const
+{
+  if (!m_Cooperative) return true;
+
+  for (auto time = from; time <= to; time++)
+  {
+    auto owner = GetOwner(cell, time);
+    if (owner != NONE && owner != agent) return false;
+  }
+
+  return true;
+}
+
+DWORD CooperativePlanner::GetOwner(DWORD cell, size_t time) const
+{
+  auto found = m_Reserved.find(GetKey(cell, time));
+  return found == m_Reserved.end() ? NONE : found->second;
+}
+
+size_t CooperativePlanner::CountConflicts(const std::vector<AgentPlan>& plans)
+{
+  size_t steps = 0;
+  for (const auto& plan : plans) steps = max(steps, plan.Steps.size());
+
+  auto position = [&plans](size_t agent, size_t time)
+  {
+    const auto& steps = plans[agent].Steps;
+    const auto& position = steps[min(time, steps.size() - 1)];
+    return (static_cast<DWORD>(position.Y) << 16) | position.X;
+  };
+
+  size_t conflicts = 0;
+  unordered_map<DWORD, DWORD> previous;
+  unordered_map<DWORD, DWORD> occupied;
+
+  for (size_t time = 0; time < steps; time++)
+  {
+    occupied.clear();
+
+    for (size_t agent = 0; agent < plans.size(); agent++)
+    {
+      if (plans[agent].Steps.empty()) continue;
+
+      auto cell = position(agent, time);
+
+      // every agent coming into taken cell is one conflict
+      if (!occupied.try_emplace(cell, static_cast<DWORD>(agent)).second) conflicts++;
+
+      if (!time) continue;
+
+      // agent which stood in our cell went into the one we left, counted once per pair
+      auto from = position(agent, time - 1);
+      auto other = previous.find(cell);
+
+      if (from != cell && other != previous.end() && other->second > agent && position(other->second, time) == from)
+      {
+        conflicts++;
+      }
+    }
+
+    swap(previous, occupied);
+  }
+
+  return conflicts;
+}
@@ -0,0 +1,292 @@
+#pragma once
+
+/*!
+ *  \brief     Cooperative multi-agent planner
+ *  \details   Windowed hierarchical cooperative A* (WHCA*) over World,
+ *             agents share space-time reservation table
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_world.h"
+
+#include <Windows.h>
+#include <vector>
+#include <unordered_map>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  One agent of batch
+  */
+  struct AgentRequest
+  {
+    Position Start;
+    Position Goal;
+  };
+
+  /*!
+  *  Planned movement of one agent
+  */
+  struct AgentPlan
+  {
+    //
+    // position per time step, first is start, agent stays at the last one
+    //
+    std::vector<Position> Steps;
+
+    //
+    // true if agent ends at its goal
+    //
+    BOOL Reached;
+
+    //
+    // cost of moves plus waits outside of goal
+    //
+    DOUBLE Cost;
+
+    //
+    // cells expanded by space-time and true distance searches of agent
+    //
+    size_t Expansions;
+
+    //
+    // planning time of agent in all rounds, milliseconds
+    //
+    DOUBLE Duration;
+
+    //
+    // moves search skipped since other agent reserved them
+    //
+    size_t Blocked;
+  };
+
+  /*!
+  *  Plans batch of agents in priority order (order of requests). Every round
+  *  each agent searches moves and waits for the next window of time steps
+  *  avoiding cells and swaps reserved by agents before it, then reserves its
+  *  own window. Agent which finds nothing stays, agents which reserved its
+  *  cell are planned again around it. All agents go half of window and the
+  *  next round starts, agents which did not move in it go first.
+  *  Heuristic is true distance to goal, found by backward search from goal
+  *  which is resumed when a cell it did not reach yet is asked
+  */
+  class CooperativePlanner
+  {
+  public:
+
+    /*!
+    *  ctor, terrain is copied from world
+    *  \param world world to plan in, it is not kept
+    *  \param window time steps each agent plans per round (from 1 to 255)
+    *  \param maxSteps time steps after which agents stop where they are,
+    *                  0 for 4 * (cols + rows)
+    *
+    *  \details throws runtime_error if window is out of range
+    */
+    CooperativePlanner(const World& world, WORD window = 16, size_t maxSteps = 0);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~CooperativePlanner() = default;
+
+    /*!
+    *  switches reservations, without them every agent plans as if it is alone,
+    *  which is what planning units one by one with FindPath gives
+    *  \param enabled true to respect reservations (default)
+    */
+    VOID SetCooperative(BOOL enabled) { m_Cooperative = enabled; }
+
+    /*!
+    *  Plans the batch
+    *  \param agents agents in priority order
+    *  \return amount of agents which reached their goals
+    *
+    *  \details throws runtime_error if position is out of map or two agents
+    *           share start cell, agent with start or goal in water stays where it is
+    */
+    size_t Plan(const std::vector<AgentRequest>& agents);
+
+    /*!
+    *  \return plans of the last batch, same order as agents
+    */
+    const std::vector<AgentPlan>& GetPlans() const { return m_Plans; }
+
+    /*!
+    *  \return amount of rounds of the last batch
+    */
+    size_t GetRounds() const { return m_Rounds; }
+
+    /*!
+    *  \return collisions left in plans of the last batch (see CountConflicts),
+    *          0 for cooperative batch
+    */
+    size_t GetConflicts() const { return m_Conflicts; }
+
+    /*!
+    *  \return duration of the last batch, milliseconds
+    */
+    DOUBLE GetDuration() const { return m_Duration; }
+
+    /*!
+    *  \return time steps agents plan per round
+    */
+    WORD GetWindow() const { return m_Window; }
+
+    /*!
+    *  Counts collisions of plans: two agents in one cell at one time step,
+    *  or two agents swapping cells in one step
+    *  \param plans plans to check
+    *  \return amount of collisions
+    */
+    static size_t CountConflicts(const std::vector<AgentPlan>& plans);
+
+  private:
+
+    /*!
+    *  cell of true distance search
+    */
+    struct DistanceCell
+    {
+      FLOAT G;
+      BOOL Closed;
+    };
+
+    /*!
+    *  open list entry, used by both searches, lowest f first, higher g wins ties
+    */
+    struct OpenEntry
+    {
+      FLOAT F;
+      FLOAT G;
+      DWORD Item;
+
+      BOOL operator<(const OpenEntry& r) const
+      {
+        if (F == r.F) return G < r.G;
+        return F > r.F;
+      }
+    };
+
+    /*!
+    *  backward search from goal of one agent, kept between rounds
+    */
+    struct TrueDistance
+    {
+      DWORD Goal;
+      DWORD Target;
+      std::unordered_map<DWORD, DistanceCell> Cells;
+      std::vector<OpenEntry> Open;
+    };
+
+    /*!
+    *  state of space-time search, cell at step of window
+    */
+    struct TimeNode
+    {
+      FLOAT G;
+      DWORD Cell;
+      DWORD Parent;
+      WORD Step;
+    };
+
+    /*!
+    *  resumes backward search until cell is closed
+    *  \param distance search of agent
+    *  \param cell cell to ask
+    *  \param expansions counter to add expanded cells to
+    *  \return cost from cell to goal (max FLOAT if goal can not be reached)
+    */
+    FLOAT GetTrueDistance(TrueDistance& distance, DWORD cell, size_t& expansions);
+
+    /*!
+    *  space-time search of one window, result is in m_Path
+    *  \param agent index of agent
+    *  \param cell cell agent is in
+    *  \param time time step window starts at
+    *  \return false if nothing is found, agent stays in cell then
+    */
+    BOOL PlanWindow(DWORD agent, DWORD cell, size_t time);
+
+    /*!
+    *  \return true if no other agent reserved cell from time till window end
+    */
+    BOOL IsFreeUntil(DWORD agent, DWORD cell, size_t from, size_t to) const;
+
+    /*!
+    *  \return agent which reserved cell at time step (MAXDWORD if cell is free)
+    */
+    DWORD GetOwner(DWORD cell, size_t time) const;
+
+    /*!
+    *  \return key of cell at time step in reservation table
+    */
+    static DWORD64 GetKey(DWORD cell, size_t time) { return (static_cast<DWORD64>(time) << 32) | cell; }
+
+    /*!
+    *  \return map position of cell
+    */
+    Position GetPosition(DWORD cell) const
+    {
+      return { static_cast<WORD>(cell % m_Cols), static_cast<WORD>(cell / m_Cols) };
+    }
+
+    //
+    // map size
+    //
+    size_t m_Cols;
+    size_t m_Rows;
+
+    //
+    // terrain cost per cell (y * cols + x), 0 or less is water
+    //
+    std::vector<FLOAT> m_Costs;
+
+    //
+    // settings
+    //
+    WORD m_Window;
+    size_t m_MaxSteps;
+    BOOL m_Cooperative;
+
+    //
+    // cell at time step -> agent which reserved it, only current round is kept,
+    // first reservation stays
+    //
+    std::unordered_map<DWORD64, DWORD> m_Reserved;
+
+    //
+    // true distance search per agent
+    //
+    std::vector<TrueDistance> m_Distances;
+
+    //
+    // space-time search arenas, reused by every window
+    //
+    std::vector<TimeNode> m_Nodes;
+    std::vector<OpenEntry> m_Open;
+    std::unordered_map<DWORD64, FLOAT> m_Visited;
+
+    //
+    // cells of the last planned window, one per time step
+    //
+    std::vector<DWORD> m_Path;
+
+    //
+    // results of the last batch
+    //
+    std::vector<AgentPlan> m_Plans;
+    size_t m_Rounds;
+    size_t m_Conflicts;
+    DOUBLE m_Duration;
+  };
+}
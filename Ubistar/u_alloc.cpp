@@ -0,0 +1,65 @@
+/*!
+ *  \brief     Heap allocation counter impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_alloc.h"
+
+#include <cstdlib>
+#include <new>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// heap allocations of calling thread, so searches on other threads do not
+// show in difference around a query; plain counter, only owner thread writes it
+static thread_local size_t threadAllocations = 0;
+
+/************************************************
+ *  Global allocation operators
+ ***********************************************/
+
+// array and nothrow forms go through this one by default
+VOID* operator new(size_t size)
+{
+  threadAllocations++;
+
+  if (auto memory = malloc(size ? size : 1))
+  {
+    return memory;
+  }
+
+  throw bad_alloc();
+}
+
+VOID operator delete(VOID* memory) noexcept
+{
+  free(memory);
+}
+
+VOID operator delete(VOID* memory, size_t) noexcept
+{
+  free(memory);
+}
+
+/************************************************
+ *  Functions impl
+ ***********************************************/
+
+size_t ubistar::GetAllocationsCount()
+{
+  return threadAllocations;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+/*!
+ *  \brief     Heap allocation counter
+ *  \details   Global operator new is replaced to count allocations
+ *             of each thread
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include <Windows.h>
+
+  /************************************************
+   *  Functions decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  \return amount of heap allocations made by calling thread so far,
+  *          replaced global operator new counts them, so difference
+  *          around a call shows how much it allocated, even while
+  *          other threads allocate
+  */
+  size_t GetAllocationsCount();
+}
@@ -9,10 +9,16 @@
   ***********************************************/
 
 #include "u_astar.h"
+#include "u_alloc.h"
 
 #include <chrono>
-#include <queue>
 #include <iostream>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <cstdint>
+#include <intrin.h>
+#include <stdexcept>
 
   /************************************************
    *  Namespaces
@@ -22,43 +28,199 @@ using namespace ubistar;
 using namespace std;
 using namespace chrono;
 
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// g of cells search did not reach yet
+constexpr FLOAT UNVISITED = numeric_limits<FLOAT>::max();
+
+// g of expanded cells, no candidate can improve it
+constexpr FLOAT CLOSED = numeric_limits<FLOAT>::lowest();
+
+// open list arena is sized by map, but not above this amount of entries
+constexpr size_t OPEN_RESERVE_LIMIT = 1 << 20;
+
 /************************************************
  *  AStar class impl
  ***********************************************/
 
-AStar::AStar(std::basic_string<TCHAR> mapPath, BYTE mapRows, BYTE mapCols, BOOL showmap)
-  : m_Weight(1.0f), m_ShowMap(showmap), m_Duration(0), m_Cost(0), m_PathFound(false)
+AStar::AStar(std::basic_string<TCHAR> mapPath, WORD mapRows, WORD mapCols, BOOL showmap, CELL_LAYOUT layout)
+  : m_Weight(1.0f), m_Start(nullptr), m_End(nullptr), m_StartX(0), m_StartY(0), m_EndX(0), m_EndY(0),
+  m_ShowMap(showmap), m_Duration(0), m_Cost(0), m_PathFound(false),
+  m_UseKernel(true), m_Expansions(0), m_Allocations(0), m_Goal(0), m_TileFaults(0), m_TilePrefetches(0),
+  m_Profiler(nullptr), m_Cancelled(nullptr), m_Deadline(steady_clock::time_point::max()),
+  m_Status(SEARCH_STATUS::COMPLETED)
+{
+  m_World = make_unique<World>(mapPath, mapRows, mapCols, layout);
+
+  // Pifagor`s formula
+  m_DiagWeight = sqrt(2 * m_Weight * m_Weight);
+
+  m_Costs = m_World->GetPaddedCosts();
+  m_Layout = &m_World->GetLayout();
+  PrepareKernelState(m_World->GetPaddedSize());
+}
+
+AStar::AStar(std::unique_ptr<SharedMap> map)
+  : m_Shared(move(map)), m_Weight(1.0f), m_Start(nullptr), m_End(nullptr),
+  m_StartX(0), m_StartY(0), m_EndX(0), m_EndY(0),
+  m_ShowMap(false), m_Duration(0), m_Cost(0), m_PathFound(false),
+  m_UseKernel(true), m_Expansions(0), m_Allocations(0), m_Goal(0), m_TileFaults(0), m_TilePrefetches(0),
+  m_Profiler(nullptr), m_Cancelled(nullptr), m_Deadline(steady_clock::time_point::max()),
+  m_Status(SEARCH_STATUS::COMPLETED)
 {
-  m_World = make_unique<World>(mapPath, mapRows, mapCols);
+  // Pifagor`s formula
+  m_DiagWeight = sqrt(2 * m_Weight * m_Weight);
+
+  // costs are read right from shared memory, only search state is own
+  m_Costs = m_Shared->GetPaddedCosts();
+  m_Layout = &m_Shared->GetLayout();
+  PrepareKernelState(m_Shared->GetPaddedSize());
+}
 
+AStar::AStar(std::unique_ptr<ChunkedWorld> world)
+  : m_Chunked(move(world)), m_Costs(nullptr), m_Layout(nullptr), m_Weight(1.0f), m_Start(nullptr), m_End(nullptr),
+  m_StartX(0), m_StartY(0), m_EndX(0), m_EndY(0),
+  m_ShowMap(false), m_Duration(0), m_Cost(0), m_PathFound(false),
+  m_UseKernel(true), m_Expansions(0), m_Allocations(0), m_Goal(0), m_TileFaults(0), m_TilePrefetches(0),
+  m_Profiler(nullptr), m_Cancelled(nullptr), m_Deadline(steady_clock::time_point::max()),
+  m_Status(SEARCH_STATUS::COMPLETED)
+{
   // Pifagor`s formula
   m_DiagWeight = sqrt(2 * m_Weight * m_Weight);
 }
 
-BOOL AStar::FindPath(BYTE startX, BYTE startY, BYTE endX, BYTE endY)
+VOID AStar::PrepareKernelState(size_t cells)
+{
+  // kernel state lives as long as the world, so searches do not allocate it again
+  m_G.resize(cells);
+  m_Parents.resize(cells);
+  m_GoalSlots.resize(cells, -1);
+
+  // open list rarely holds more than all cells, path rarely goes around map twice
+  auto openReserve = min(cells, OPEN_RESERVE_LIMIT);
+  m_Context.Open.reserve(openReserve);
+  m_Context.OpenCoords.reserve(m_World ? openReserve : 0);
+  m_Context.Moves.reserve(2 * (GetMapCols() + GetMapRows()));
+  m_Context.Result.Reserve(m_Context.Moves.capacity());
+}
+
+const Path& AStar::FindPath(WORD startX, WORD startY, WORD endX, WORD endY)
 {
   auto start = high_resolution_clock::now();
+  auto allocations = GetAllocationsCount();
+
+  m_StartX = startX;
+  m_StartY = startY;
+  m_EndX = endX;
+  m_EndY = endY;
+  m_Cost = 0;
+  m_Expansions = 0;
+  m_Status = SEARCH_STATUS::COMPLETED;
+  m_Context.Result.Clear();
 
-  m_Start = m_World->GetCoord(startX, startY);
-  m_End = m_World->GetCoord(endX, endY);
+  EnterPhase(SEARCH_PHASE::RESET);
 
-  // check initially, do we have to do anything
-  if (m_Start->GetTerrainType() == TERRAIN_TYPE::UNDEFINED || 
-    m_Start->GetTerrainType() == TERRAIN_TYPE::WATER ||
-    m_End->GetTerrainType() == TERRAIN_TYPE::UNDEFINED ||
-    m_End->GetTerrainType() == TERRAIN_TYPE::WATER)
+  if (m_Chunked)
   {
-    m_PathFound = false;
+    auto faults = m_Chunked->GetFaults();
+    auto prefetches = m_Chunked->GetPrefetches();
 
-    auto end = high_resolution_clock::now();
-    m_Duration = duration_cast<microseconds>(end - start).count() / 1000.0;
-    m_Cost = 0;
+    m_PathFound = SearchChunked();
 
-    return m_PathFound;
+    m_TileFaults = m_Chunked->GetFaults() - faults;
+    m_TilePrefetches = m_Chunked->GetPrefetches() - prefetches;
+  }
+  else if (m_Shared)
+  {
+    // shared map has no tiles to reset and is searched only by kernel
+    m_PathFound = m_Costs[GetIndex(startX, startY)] > 0.0f && m_Costs[GetIndex(endX, endY)] > 0.0f && SearchByKernel();
+  }
+  else
+  {
+    m_Start = m_World->GetCoord(startX, startY);
+    m_End = m_World->GetCoord(endX, endY);
+
+    // check initially, do we have to do anything
+    if (m_Start->GetTerrainType() == TERRAIN_TYPE::UNDEFINED ||
+      m_Start->GetTerrainType() == TERRAIN_TYPE::WATER ||
+      m_End->GetTerrainType() == TERRAIN_TYPE::UNDEFINED ||
+      m_End->GetTerrainType() == TERRAIN_TYPE::WATER)
+    {
+      m_PathFound = false;
+    }
+    else
+    {
+      m_World->ResetValues();
+      m_PathFound = m_UseKernel ? SearchByKernel() : SearchByDirections();
+    }
   }
 
-  m_World->ResetValues();
+  if (m_Profiler) m_Profiler->EndQuery();
 
+  auto end = high_resolution_clock::now();
+  m_Duration = duration_cast<microseconds>(end - start).count() / 1000.0;
+  m_Allocations = GetAllocationsCount() - allocations;
+
+  return m_Context.Result;
+}
+
+BOOL AStar::FindNearestGoal(WORD startX, WORD startY, const std::vector<Position>& goals)
+{
+  return FindGoals(startX, startY, goals, true);
+}
+
+BOOL AStar::FindCostsToGoals(WORD startX, WORD startY, const std::vector<Position>& goals)
+{
+  return FindGoals(startX, startY, goals, false);
+}
+
+BOOL AStar::FindGoals(WORD startX, WORD startY, const std::vector<Position>& goals, BOOL nearest)
+{
+  // goal costs are kept per cell of world, chunked one has no such store
+  if (m_Chunked)
+  {
+    throw runtime_error("multi goal search is not supported on chunked maps");
+  }
+
+  auto start = high_resolution_clock::now();
+  auto allocations = GetAllocationsCount();
+
+  m_StartX = startX;
+  m_StartY = startY;
+  m_EndX = goals.empty() ? startX : goals.front().X;
+  m_EndY = goals.empty() ? startY : goals.front().Y;
+  m_Cost = 0;
+  m_Expansions = 0;
+  m_Status = SEARCH_STATUS::COMPLETED;
+  m_Goal = 0;
+  m_GoalCosts.assign(goals.size(), -1.0);
+  m_Context.Result.Clear();
+
+  EnterPhase(SEARCH_PHASE::RESET);
+
+  if (startX >= GetMapCols() || startY >= GetMapRows())
+  {
+    m_PathFound = false;
+  }
+  else
+  {
+    if (m_World) m_World->ResetValues();
+    m_PathFound = SearchGoals(goals, nearest);
+  }
+
+  if (m_Profiler) m_Profiler->EndQuery();
+
+  auto end = high_resolution_clock::now();
+  m_Duration = duration_cast<microseconds>(end - start).count() / 1000.0;
+  m_Allocations = GetAllocationsCount() - allocations;
+
+  return m_PathFound;
+}
+
+BOOL AStar::SearchByDirections()
+{
   // initial start cell is not counted, we already reach it
   m_Start->SetTravelCost(0.0f);
   m_Start->MarkAsPath();
@@ -75,24 +237,33 @@ BOOL AStar::FindPath(BYTE startX, BYTE startY, BYTE endX, BYTE endY)
     return l->GetTotalCost() > r->GetTotalCost();
   };
 
-  priority_queue<Coordinate*, vector<Coordinate*>, decltype(cmp)> open(cmp);
+  // binary heap over context arena, same as priority queue but memory stays
+  auto& open = m_Context.OpenCoords;
+  open.clear();
 
-  open.push(m_Start);
+  open.push_back(m_Start);
   Coordinate* current = nullptr;
+  BOOL found = false;
+
+  EnterPhase(SEARCH_PHASE::EXPANSION);
 
   while (!open.empty())
   {
     // pick the best option (it is on the top)
-    current = open.top();
+    current = open.front();
 
     if (current == m_End)
     {
-      m_PathFound = true;
+      found = true;
       break;
     }
 
-    open.pop();
+    pop_heap(open.begin(), open.end(), cmp);
+    open.pop_back();
     current->MarkAsChoosen();
+    m_Expansions++;
+
+    if (IsStopRequested()) break;
 
     // iterate all possible neighbours
     for (const auto& direction : DIRECTIONS)
@@ -117,27 +288,467 @@ BOOL AStar::FindPath(BYTE startX, BYTE startY, BYTE endX, BYTE endY)
       {
         neighbour->SetH(CalcH(neighbour, m_End));
         neighbour->MarkAsVisited();
-        open.push(neighbour);
+        open.push_back(neighbour);
+        push_heap(open.begin(), open.end(), cmp);
       }
     }
   }
 
-  if (m_PathFound)
+  if (found)
   {
     // trace back
-    do
+    EnterPhase(SEARCH_PHASE::TRACE);
+    m_Context.Moves.clear();
+
+    // start is already marked and costs nothing
+    while (current != m_Start)
     {
-      if (nullptr == current) break;
       current->MarkAsPath();
+
+      auto parent = current->GetParent();
+      m_Context.Moves.push_back(Path::GetDirection(current->GetX() - parent->GetX(), current->GetY() - parent->GetY()));
+
       m_Cost += current->GetTravelCost();
-      current = current->GetParent();
-    } while (current != m_Start);
+      current = parent;
+    }
+
+    BuildPath({ m_Start->GetX(), m_Start->GetY() });
   }
 
-  auto end = high_resolution_clock::now();
-  m_Duration = duration_cast<microseconds>(end - start).count() / 1000.0;
+  return found;
+}
 
-  return m_PathFound;
+BOOL AStar::SearchByKernel()
+{
+  fill(m_G.begin(), m_G.end(), UNVISITED);
+
+  const auto& layout = *m_Layout;
+  const auto startIndex = static_cast<DWORD>(GetIndex(m_StartX, m_StartY));
+  const auto endIndex = static_cast<DWORD>(GetIndex(m_EndX, m_EndY));
+
+  ExpansionInput input = {};
+  input.Costs = m_Costs;
+  input.G = m_G.data();
+  input.EndX = m_EndX;
+  input.EndY = m_EndY;
+  input.Weight = m_Weight;
+  input.DiagWeight = m_DiagWeight;
+
+  DWORD neighbours[NEIGHBOURS_COUNT];
+  FLOAT newG[NEIGHBOURS_COUNT];
+  FLOAT newH[NEIGHBOURS_COUNT];
+  input.Neighbours = neighbours;
+
+  m_Context.Open.clear();
+
+  m_G[startIndex] = 0.0f;
+  m_Parents[startIndex] = startIndex;
+  PushOpen({ 0.0f, 0.0f, 0.0f, startIndex, m_StartX, m_StartY });
+
+  BOOL found = false;
+
+  EnterPhase(SEARCH_PHASE::EXPANSION);
+
+  while (!m_Context.Open.empty())
+  {
+    auto current = PopOpen();
+
+    // outdated entry, cell already has better g or is closed
+    if (current.G > m_G[current.Index]) continue;
+
+    if (current.Index == endIndex)
+    {
+      m_Cost = current.G;
+      found = true;
+      break;
+    }
+
+    m_G[current.Index] = CLOSED;
+    m_Expansions++;
+
+    if (IsStopRequested()) break;
+
+    // border shifts padded position by one
+    layout.GetNeighbours(current.Index, static_cast<size_t>(current.X) + 1,
+      static_cast<size_t>(current.Y) + 1, neighbours);
+
+    input.CurrentG = current.G;
+    input.X = current.X;
+    input.Y = current.Y;
+
+    auto improved = ExpandNeighbours(input, newG, newH);
+
+    // only improved neighbours reach the open list
+    while (improved)
+    {
+      unsigned long i;
+      _BitScanForward(&i, improved);
+      improved &= improved - 1;
+
+      m_G[neighbours[i]] = newG[i];
+      m_Parents[neighbours[i]] = current.Index;
+      PushOpen({ newG[i] + newH[i], newH[i], newG[i], neighbours[i],
+        static_cast<WORD>(current.X + DIRECTION_DX[i]), static_cast<WORD>(current.Y + DIRECTION_DY[i]) });
+    }
+  }
+
+  if (found)
+  {
+    // trace back, cost is already known from g of the end
+    TracePath(startIndex, endIndex);
+  }
+
+  return found;
+}
+
+BOOL AStar::SearchChunked()
+{
+  // kernel reads costs and g gathered into small arrays, so indexes are fixed
+  const DWORD LOCAL_NEIGHBOURS[NEIGHBOURS_COUNT] = { 0, 1, 2, 3, 4, 5, 6, 7 };
+
+  const auto cols = static_cast<DWORD64>(m_Chunked->GetCols());
+  auto key = [cols](INT x, INT y) { return (static_cast<DWORD64>(y) * cols) + x; };
+
+  if (m_Chunked->GetTerrainCost(m_StartX, m_StartY) <= 0.0f ||
+    m_Chunked->GetTerrainCost(m_EndX, m_EndY) <= 0.0f)
+  {
+    return false;
+  }
+
+  m_Sparse.clear();
+
+  FLOAT costs[NEIGHBOURS_COUNT];
+  FLOAT storedG[NEIGHBOURS_COUNT];
+  FLOAT newG[NEIGHBOURS_COUNT];
+  FLOAT newH[NEIGHBOURS_COUNT];
+
+  ExpansionInput input = {};
+  input.Costs = costs;
+  input.G = storedG;
+  input.Neighbours = LOCAL_NEIGHBOURS;
+  input.EndX = m_EndX;
+  input.EndY = m_EndY;
+  input.Weight = m_Weight;
+  input.DiagWeight = m_DiagWeight;
+
+  m_Context.Open.clear();
+
+  m_Sparse[key(m_StartX, m_StartY)] = { 0.0f, 0 };
+  PushOpen({ 0.0f, 0.0f, 0.0f, 0, m_StartX, m_StartY });
+
+  EnterPhase(SEARCH_PHASE::EXPANSION);
+
+  while (!m_Context.Open.empty())
+  {
+    auto current = PopOpen();
+
+    auto& currentCell = m_Sparse[key(current.X, current.Y)];
+
+    // outdated entry, cell already has better g or is closed
+    if (current.G > currentCell.G) continue;
+
+    if (current.X == m_EndX && current.Y == m_EndY)
+    {
+      m_Cost = current.G;
+
+      // every reached cell knows the move it was reached by, so path goes back by them
+      EnterPhase(SEARCH_PHASE::TRACE);
+      m_Context.Moves.clear();
+
+      for (auto x = m_EndX, y = m_EndY; x != m_StartX || y != m_StartY; )
+      {
+        auto move = m_Sparse[key(x, y)].Move;
+        m_Context.Moves.push_back(move);
+
+        x = static_cast<WORD>(x - DIRECTION_DX[move]);
+        y = static_cast<WORD>(y - DIRECTION_DY[move]);
+      }
+
+      BuildPath({ m_StartX, m_StartY });
+
+      return true;
+    }
+
+    currentCell.G = CLOSED;
+    m_Expansions++;
+
+    if (IsStopRequested()) return false;
+
+    // frontier is close to the tile edge, next tile will be needed soon
+    m_Chunked->PrefetchAround(current.X, current.Y);
+
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      auto x = current.X + DIRECTION_DX[i];
+      auto y = current.Y + DIRECTION_DY[i];
+
+      costs[i] = m_Chunked->GetTerrainCost(x, y);
+      storedG[i] = UNVISITED;
+
+      if (costs[i] > 0.0f)
+      {
+        auto found = m_Sparse.find(key(x, y));
+        if (found != m_Sparse.end()) storedG[i] = found->second.G;
+      }
+    }
+
+    input.CurrentG = current.G;
+    input.X = current.X;
+    input.Y = current.Y;
+
+    auto improved = ExpandNeighbours(input, newG, newH);
+
+    while (improved)
+    {
+      unsigned long i;
+      _BitScanForward(&i, improved);
+      improved &= improved - 1;
+
+      auto x = static_cast<WORD>(current.X + DIRECTION_DX[i]);
+      auto y = static_cast<WORD>(current.Y + DIRECTION_DY[i]);
+
+      m_Sparse[key(x, y)] = { newG[i], static_cast<BYTE>(i) };
+      PushOpen({ newG[i] + newH[i], newH[i], newG[i], 0, x, y });
+    }
+  }
+
+  return false;
+}
+
+BOOL AStar::SearchGoals(const std::vector<Position>& goals, BOOL nearest)
+{
+  const auto costs = m_Costs;
+  const auto startIndex = static_cast<DWORD>(GetIndex(m_StartX, m_StartY));
+
+  if (costs[startIndex] <= 0.0f) return false;
+
+  // goals are marked in padded grid, goals on the same cell share slot of the
+  // first one, goals out of the map or on water stay unreachable
+  auto& goalCells = m_Context.GoalCells;
+  auto& validGoals = m_Context.ValidGoals;
+  goalCells.assign(goals.size(), SIZE_MAX);
+  validGoals.clear();
+  size_t distinctGoals = 0;
+
+  for (size_t i = 0; i < goals.size(); i++)
+  {
+    if (goals[i].X >= GetMapCols() || goals[i].Y >= GetMapRows()) continue;
+
+    auto index = GetIndex(goals[i].X, goals[i].Y);
+    if (costs[index] <= 0.0f) continue;
+
+    goalCells[i] = index;
+    validGoals.push_back(goals[i]);
+
+    if (m_GoalSlots[index] < 0)
+    {
+      m_GoalSlots[index] = static_cast<INT>(i);
+      distinctGoals++;
+    }
+  }
+
+  // minimum over goals keeps heuristic consistent, so first reached goal is the nearest
+  auto calcH = [&](WORD x, WORD y)
+  {
+    auto best = numeric_limits<FLOAT>::max();
+
+    for (const auto& goal : validGoals)
+    {
+      auto dx = static_cast<FLOAT>(x) - goal.X;
+      auto dy = static_cast<FLOAT>(y) - goal.Y;
+      best = min(best, (dx * dx) + (dy * dy));
+    }
+
+    return m_Weight * sqrtf(best);
+  };
+
+  fill(m_G.begin(), m_G.end(), UNVISITED);
+
+  const auto& layout = *m_Layout;
+
+  // heuristic is calculated here, kernel one goes to start and is not used
+  ExpansionInput input = {};
+  input.Costs = costs;
+  input.G = m_G.data();
+  input.EndX = m_StartX;
+  input.EndY = m_StartY;
+  input.Weight = m_Weight;
+  input.DiagWeight = m_DiagWeight;
+
+  DWORD neighbours[NEIGHBOURS_COUNT];
+  FLOAT newG[NEIGHBOURS_COUNT];
+  FLOAT newH[NEIGHBOURS_COUNT];
+  input.Neighbours = neighbours;
+
+  m_Context.Open.clear();
+
+  m_G[startIndex] = 0.0f;
+  m_Parents[startIndex] = startIndex;
+  PushOpen({ 0.0f, 0.0f, 0.0f, startIndex, m_StartX, m_StartY });
+
+  BOOL found = false;
+  DWORD endIndex = startIndex;
+  size_t reached = 0;
+
+  EnterPhase(SEARCH_PHASE::EXPANSION);
+
+  while (distinctGoals && !m_Context.Open.empty())
+  {
+    auto current = PopOpen();
+
+    // outdated entry, cell already has better g or is closed
+    if (current.G > m_G[current.Index]) continue;
+
+    auto slot = m_GoalSlots[current.Index];
+
+    if (slot >= 0)
+    {
+      m_GoalCosts[slot] = current.G;
+      found = true;
+      reached++;
+
+      if (nearest)
+      {
+        m_Goal = slot;
+        m_Cost = current.G;
+        endIndex = current.Index;
+        break;
+      }
+
+      if (reached == distinctGoals) break;
+    }
+
+    m_G[current.Index] = CLOSED;
+    m_Expansions++;
+
+    if (IsStopRequested()) break;
+
+    layout.GetNeighbours(current.Index, static_cast<size_t>(current.X) + 1,
+      static_cast<size_t>(current.Y) + 1, neighbours);
+
+    input.CurrentG = current.G;
+    input.X = current.X;
+    input.Y = current.Y;
+
+    auto improved = ExpandNeighbours(input, newG, newH);
+
+    while (improved)
+    {
+      unsigned long i;
+      _BitScanForward(&i, improved);
+      improved &= improved - 1;
+
+      auto x = static_cast<WORD>(current.X + DIRECTION_DX[i]);
+      auto y = static_cast<WORD>(current.Y + DIRECTION_DY[i]);
+      auto h = nearest ? calcH(x, y) : 0.0f;
+
+      m_G[neighbours[i]] = newG[i];
+      m_Parents[neighbours[i]] = current.Index;
+      PushOpen({ newG[i] + h, h, newG[i], neighbours[i], x, y });
+    }
+  }
+
+  // goals sharing a cell get cost of the first one, then slots are cleared
+  for (size_t i = 0; i < goals.size(); i++)
+  {
+    if (goalCells[i] == SIZE_MAX) continue;
+    m_GoalCosts[i] = m_GoalCosts[m_GoalSlots[goalCells[i]]];
+  }
+
+  for (auto index : goalCells)
+  {
+    if (index != SIZE_MAX) m_GoalSlots[index] = -1;
+  }
+
+  // stopped search reports nothing, costs of goals reached before stop stay
+  if (m_Status != SEARCH_STATUS::COMPLETED) found = false;
+
+  if (found && nearest)
+  {
+    m_EndX = goals[m_Goal].X;
+    m_EndY = goals[m_Goal].Y;
+    if (m_World)
+    {
+      m_Start = m_World->GetCoord(m_StartX, m_StartY);
+      m_End = m_World->GetCoord(m_EndX, m_EndY);
+    }
+
+    TracePath(startIndex, endIndex);
+  }
+
+  return found;
+}
+
+BOOL AStar::CheckStopCondition()
+{
+  if (m_Cancelled && m_Cancelled->load(memory_order_relaxed))
+  {
+    m_Status = SEARCH_STATUS::CANCELLED;
+  }
+  else if (steady_clock::now() >= m_Deadline)
+  {
+    m_Status = SEARCH_STATUS::EXPIRED;
+  }
+
+  return m_Status != SEARCH_STATUS::COMPLETED;
+}
+
+VOID AStar::PushOpen(const OpenCell& cell)
+{
+  m_Context.Open.push_back(cell);
+  push_heap(m_Context.Open.begin(), m_Context.Open.end(), OpenCellOrder());
+}
+
+AStar::OpenCell AStar::PopOpen()
+{
+  pop_heap(m_Context.Open.begin(), m_Context.Open.end(), OpenCellOrder());
+  auto cell = m_Context.Open.back();
+  m_Context.Open.pop_back();
+
+  return cell;
+}
+
+VOID AStar::TracePath(DWORD startIndex, DWORD endIndex)
+{
+  EnterPhase(SEARCH_PHASE::TRACE);
+
+  m_Context.Moves.clear();
+
+  // shared map has no tiles, position of parent is found among neighbours
+  DWORD neighbours[NEIGHBOURS_COUNT];
+  auto x = m_EndX;
+  auto y = m_EndY;
+
+  if (m_World) m_World->GetCoordByIndex(endIndex)->MarkAsPath();
+
+  for (auto index = endIndex; index != startIndex; )
+  {
+    auto parent = m_Parents[index];
+    m_Layout->GetNeighbours(index, static_cast<size_t>(x) + 1, static_cast<size_t>(y) + 1, neighbours);
+
+    BYTE i = 0;
+    while (i < NEIGHBOURS_COUNT - 1 && neighbours[i] != parent) i++;
+
+    m_Context.Moves.push_back(Path::GetDirection(-DIRECTION_DX[i], -DIRECTION_DY[i]));
+
+    x = static_cast<WORD>(x + DIRECTION_DX[i]);
+    y = static_cast<WORD>(y + DIRECTION_DY[i]);
+    index = parent;
+
+    if (m_World) m_World->GetCoordByIndex(index)->MarkAsPath();
+  }
+
+  BuildPath({ x, y });
+}
+
+VOID AStar::BuildPath(Position start)
+{
+  m_Context.Result.Reset(start);
+
+  for (auto move = m_Context.Moves.rbegin(); move != m_Context.Moves.rend(); move++)
+  {
+    m_Context.Result.Push(*move);
+  }
 }
 
 FLOAT AStar::CalcH(const Coordinate* const start, const Coordinate* const end)
@@ -170,20 +781,32 @@ FLOAT AStar::CalcG(const FLOAT& currentG, const FLOAT& neighbourT, const DIRECTI
 
 VOID AStar::Print()
 {
-  cout << endl;
+  // whole report goes to console by one write, map rows do not flush one by one
+  ostringstream out;
 
-  cout << "Start position: (" << static_cast<INT>(GetLastStart()->GetX()) 
-    << ", " << static_cast<INT>(GetLastStart()->GetY()) << ")" << endl;
-  cout << "End position: (" << static_cast<INT>(GetLastEnd()->GetX())
-    << ", " << static_cast<INT>(GetLastEnd()->GetY()) << ")" << endl << endl;
+  out << '\n';
 
-  cout << "Path found: " << (IsLastFound() ? "true" : "false") << endl;
-  cout << "Path cost: " << GetLastCost() << endl << endl;
+  out << "Start position: (" << m_StartX << ", " << m_StartY << ")" << '\n';
+  out << "End position: (" << m_EndX << ", " << m_EndY << ")" << '\n' << '\n';
 
-  cout << "Total duration: " << GetLastDuration() << " ms" << endl;
+  out << "Path found: " << (IsLastFound() ? "true" : "false") << '\n';
+  out << "Path cost: " << GetLastCost() << '\n' << '\n';
+  out << "Total duration: " << GetLastDuration() << " ms" << '\n';
 
-  if (IsMapShown())
+  if (m_Chunked)
   {
-    m_World->Print();
+    out << '\n';
+    out << "Tile faults: " << GetLastTileFaults() << '\n';
+    out << "Tile prefetches: " << GetLastTilePrefetches() << '\n';
   }
+
+  auto text = out.str();
+
+  if (IsMapShown() && m_World)
+  {
+    m_World->Render(text);
+  }
+
+  cout.write(text.data(), text.size());
+  cout.flush();
 }
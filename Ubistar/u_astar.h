@@ -12,10 +12,19 @@
   ***********************************************/
 
 #include "u_world.h"
+#include "u_expand.h"
+#include "u_chunked.h"
+#include "u_path.h"
+#include "u_registry.h"
+#include "u_profile.h"
 
 #include <Windows.h>
 #include <string>
 #include <memory>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <chrono>
 
   /************************************************
    *  class decl
@@ -23,6 +32,27 @@
 
 namespace ubistar
 {
+  /*!
+  *  How the last search ended
+  */
+  enum class SEARCH_STATUS
+  {
+    //
+    // search went until path was found or open list was empty
+    //
+    COMPLETED,
+
+    //
+    // cancel flag was set while search went
+    //
+    CANCELLED,
+
+    //
+    // deadline passed while search went
+    //
+    EXPIRED
+  };
+
   /*!
   *  Class wrapping algorithm
   */
@@ -36,10 +66,25 @@ namespace ubistar
     *  \param mapRows maximum amount of rows in map
     *  \param mapCols maximum amount of cols in map
     *  \param showmap should map finally printed
+    *  \param layout order of cells in world memory
     * 
     *  \details also bunch of internal params initialized with default values
     */
-    AStar(std::basic_string<TCHAR> mapPath, BYTE mapRows, BYTE mapCols, BOOL showmap);
+    AStar(std::basic_string<TCHAR> mapPath, WORD mapRows, WORD mapCols, BOOL showmap,
+      CELL_LAYOUT layout = CELL_LAYOUT::ROW_MAJOR);
+
+    /*!
+    *  ctor to search in chunked world, tiles are loaded while search goes
+    *  \param world opened chunked world
+    */
+    AStar(std::unique_ptr<ChunkedWorld> world);
+
+    /*!
+    *  ctor to search in map attached from shared memory, costs are not copied,
+    *  search goes by kernel only
+    *  \param map attached shared map
+    */
+    AStar(std::unique_ptr<SharedMap> map);
 
     /*!
     *  default dtor, no need to remove anything here by hand
@@ -57,15 +102,139 @@ namespace ubistar
     *           then we go for general implementation of A*
     *           good explanation of the algorithm (https://youtu.be/-L-WgKMFuhE)
     * 
-    *  \return true if path is found, false otherwise
+    *  \return found path, it converts to false if there is no path,
+    *          it stays valid until the next search
+    */
+    const Path& FindPath(WORD startX, WORD startY, WORD endX, WORD endY);
+
+    /*!
+    *  One search to the closest of several goals, heuristic is minimum
+    *  over all goals, path to found goal is marked same way as in FindPath
+    *  \param startX x coordinate (col) of start pos
+    *  \param startY y coordinate (row) of start pos
+    *  \param goals candidate end positions
+    *
+    *  \details cost of found goal is in GetLastCost, its index in GetLastGoal,
+    *           throws runtime_error on chunked world
+    *
+    *  \return true if any goal is reachable
+    */
+    BOOL FindNearestGoal(WORD startX, WORD startY, const std::vector<Position>& goals);
+
+    /*!
+    *  One Dijkstra expansion from start, it stops once every goal is reached
+    *  \param startX x coordinate (col) of start pos
+    *  \param startY y coordinate (row) of start pos
+    *  \param goals end positions
+    *
+    *  \details costs are in GetLastGoalCosts, throws runtime_error on chunked world
+    *
+    *  \return true if at least one goal is reachable
+    */
+    BOOL FindCostsToGoals(WORD startX, WORD startY, const std::vector<Position>& goals);
+
+    /*!
+    *  \return index of goal found by the last call to FindNearestGoal
+    */
+    size_t GetLastGoal() const { return m_Goal; }
+
+    /*!
+    *  \return cost to every goal of the last call to FindCostsToGoals
+    *          (-1 for unreachable goal), FindNearestGoal fills only found one
+    */
+    const std::vector<DOUBLE>& GetLastGoalCosts() const { return m_GoalCosts; }
+
+    /*!
+    *  switches between vectorised expansion kernel (default)
+    *  and original per direction expansion
+    *  \param enabled true to use kernel
+    */
+    VOID SetKernelEnabled(BOOL enabled) { m_UseKernel = enabled; }
+
+    /*!
+    *  \return true if FindPath goes through expansion kernel
+    */
+    BOOL IsKernelEnabled() const { return m_UseKernel; }
+
+    /*!
+    *  searches report their phases to profiler. Its sums are not atomic, so
+    *  searchers may share it only when they run on one thread, as server ones
+    *  do; each AsyncPathFinder worker needs its own
+    *  \param profiler profiler to report to, nullptr to stop profiling (default)
+    */
+    VOID SetProfiler(PhaseProfiler* profiler) { m_Profiler = profiler; }
+
+    /*!
+    *  searches check cancel flag and deadline every few expansions and give up
+    *  once either is hit, path is not found then and GetLastStatus tells why
+    *  \param cancelled flag to check, not owned (nullptr to never cancel)
+    *  \param deadline time to give up at (time_point::max() for no deadline)
+    */
+    VOID SetStopCondition(const std::atomic<BOOL>* cancelled, std::chrono::steady_clock::time_point deadline)
+    {
+      m_Cancelled = cancelled;
+      m_Deadline = deadline;
+    }
+
+    /*!
+    *  \return name of cells order in world memory
+    */
+    const CHAR* GetLayoutName() const { return m_Layout ? m_Layout->GetName() : "chunked"; }
+
+    /*!
+    *  \return map size, valid positions are below it
+    */
+    size_t GetMapCols() const { return m_World ? m_World->GetCols() : m_Shared ? m_Shared->GetCols() : m_Chunked->GetCols(); }
+    size_t GetMapRows() const { return m_World ? m_World->GetRows() : m_Shared ? m_Shared->GetRows() : m_Chunked->GetRows(); }
+
+    /*!
+    *  \return amount of cells world keeps, including border and layout alignment
+    */
+    size_t GetCellsInMemory() const { return m_World ? m_World->GetPaddedSize() : m_Shared ? m_Shared->GetPaddedSize() : 0; }
+
+    /*!
+    *  \return attached shared map (nullptr if map is not shared)
+    */
+    const SharedMap* GetSharedMap() const { return m_Shared.get(); }
+
+    /*!
+    *  \return amount of cells expanded by the last call to FindPath
+    */
+    size_t GetLastExpansions() const { return m_Expansions; }
+
+    /*!
+    *  \return amount of heap allocations made by the last call to FindPath,
+    *          0 once arenas of query context grew to fit the queries
+    *          (chunked world search still allocates its hash map and tiles)
+    */
+    size_t GetLastAllocations() const { return m_Allocations; }
+
+    /*!
+    *  \return path found by the last call to FindPath or FindNearestGoal
     */
-    BOOL FindPath(BYTE startX, BYTE startY, BYTE endX, BYTE endY);
+    const Path& GetLastPath() const { return m_Context.Result; }
+
+    /*!
+    *  \return amount of tiles chunked world had to read from file while last search
+    */
+    size_t GetLastTileFaults() const { return m_TileFaults; }
+
+    /*!
+    *  \return amount of tiles chunked world prefetched while last search,
+    *          they are counted in tile faults as well
+    */
+    size_t GetLastTilePrefetches() const { return m_TilePrefetches; }
 
     /*!
     *  \return duration of the last call to FindPath
     */
     DOUBLE GetLastDuration() const { return m_Duration; }
 
+    /*!
+    *  \return how the last search ended
+    */
+    SEARCH_STATUS GetLastStatus() const { return m_Status; }
+
     /*!
     *  \return last status of the FindPath call
     */
@@ -81,6 +250,7 @@ namespace ubistar
     *          all values are in World class
     *          anyone else has only references
     *          it helps to avoid additional copying
+    *          (nullptr for chunked world)
     */
     Coordinate* GetLastStart() const { return m_Start; }
 
@@ -95,12 +265,172 @@ namespace ubistar
     DOUBLE GetLastCost() const { return m_Cost; }
 
     /*!
-    *  printing to std out. TODO need to replace by << operator overload
+    *  printing to std out by one write. TODO need to replace by << operator overload
     */
     VOID Print();
 
   private:
 
+    /*!
+    *  cell which may be expanded, g is copied to skip entries
+    *  which became outdated after cell got better g or was closed,
+    *  position is kept to avoid decoding it from index
+    */
+    struct OpenCell
+    {
+      FLOAT F;
+      FLOAT H;
+      FLOAT G;
+      DWORD Index;
+      WORD X;
+      WORD Y;
+    };
+
+    /*!
+    *  same ordering as in SearchByDirections, lowest f first, lower h wins ties
+    */
+    struct OpenCellOrder
+    {
+      BOOL operator()(const OpenCell& l, const OpenCell& r) const
+      {
+        if (l.F == r.F)
+        {
+          return l.H > r.H;
+        }
+
+        return l.F > r.F;
+      }
+    };
+
+    /*!
+    *  arenas reused by every query, they are sized in ctor and only
+    *  cleared between queries, so steady state search does not allocate,
+    *  a query larger than all before grows them once
+    */
+    struct QueryContext
+    {
+      //
+      // open lists as binary heaps, of kernel searches and of SearchByDirections
+      //
+      std::vector<OpenCell> Open;
+      std::vector<Coordinate*> OpenCoords;
+
+      //
+      // path output and its moves from end to start while tracing back
+      //
+      Path Result;
+      std::vector<BYTE> Moves;
+
+      //
+      // multi goal scratch: padded index per goal and goals inside the map
+      //
+      std::vector<size_t> GoalCells;
+      std::vector<Position> ValidGoals;
+    };
+
+    /*!
+    *  open list operations over context arena
+    */
+    VOID PushOpen(const OpenCell& cell);
+    OpenCell PopOpen();
+
+    /*!
+    *  reached cell of chunked search, move is the one it was reached by
+    */
+    struct SparseCell
+    {
+      FLOAT G;
+      BYTE Move;
+    };
+
+    /*!
+    *  fills path output going by parents from end to start
+    *  \param startIndex padded index of start
+    *  \param endIndex padded index of end
+    */
+    VOID TracePath(DWORD startIndex, DWORD endIndex);
+
+    /*!
+    *  fills path output from moves collected while tracing back
+    *  \param start first cell of the path
+    */
+    VOID BuildPath(Position start);
+
+    /*!
+    *  switches profiler to the phase search has reached
+    *  \param phase phase search goes to
+    */
+    VOID EnterPhase(SEARCH_PHASE phase)
+    {
+      if (m_Profiler) m_Profiler->Enter(phase);
+    }
+
+    /*!
+    *  checks stop condition, only every few expansions since reading clock costs
+    *  more than expansion itself
+    *  \return true if search has to give up, status is set then
+    */
+    BOOL IsStopRequested()
+    {
+      if (m_Expansions % STOP_CHECK_INTERVAL || (!m_Cancelled && m_Deadline == std::chrono::steady_clock::time_point::max())) return false;
+
+      return CheckStopCondition();
+    }
+
+    /*!
+    *  reads cancel flag and clock
+    *  \return true if search has to give up, status is set then
+    */
+    BOOL CheckStopCondition();
+
+    /*!
+    *  sizes search state and arenas of kernel searches
+    *  \param cells amount of cells in padded grid
+    */
+    VOID PrepareKernelState(size_t cells);
+
+    /*!
+    *  \return index of map position in padded grid
+    */
+    size_t GetIndex(WORD x, WORD y) const
+    {
+      return m_Layout->GetIndex(static_cast<size_t>(x) + 1, static_cast<size_t>(y) + 1);
+    }
+
+    /*!
+    *  original search, neighbours are visited one by one through World
+    *  \return true if path is found
+    */
+    BOOL SearchByDirections();
+
+    /*!
+    *  search over padded cost grid, all neighbours of the cell
+    *  are checked at once by ExpandNeighbours
+    *  \return true if path is found
+    */
+    BOOL SearchByKernel();
+
+    /*!
+    *  search over chunked world, search state is kept only for
+    *  reached cells, neighbours are checked by ExpandNeighbours
+    *  \return true if path is found
+    */
+    BOOL SearchChunked();
+
+    /*!
+    *  search from start to several goals over padded cost grid
+    *  \param goals end positions
+    *  \param nearest true to stop on the first reached goal,
+    *         false to reach all of them (heuristic is 0 then)
+    *  \return true if any goal is reached
+    */
+    BOOL SearchGoals(const std::vector<Position>& goals, BOOL nearest);
+
+    /*!
+    *  common part of FindNearestGoal and FindCostsToGoals
+    */
+    BOOL FindGoals(WORD startX, WORD startY, const std::vector<Position>& goals, BOOL nearest);
+
     /*!
     *  calculating heuristic value. It is value from start coodinate to end
     *  ignoring walls. Actually it is just euclidian diff between to points
@@ -124,6 +454,23 @@ namespace ubistar
     //
     std::unique_ptr<World> m_World;
 
+    //
+    // chunked world, used instead of m_World if set
+    //
+    std::unique_ptr<ChunkedWorld> m_Chunked;
+
+    //
+    // shared map, used instead of m_World if set
+    //
+    std::unique_ptr<SharedMap> m_Shared;
+
+    //
+    // padded costs and their layout kernel searches go over,
+    // owned by m_World or m_Shared (nullptr for chunked world)
+    //
+    const FLOAT* m_Costs;
+    const CellLayout* m_Layout;
+
     //
     // Multipler to vert or horizontal movement
     //
@@ -144,6 +491,14 @@ namespace ubistar
     //
     Coordinate* m_End;
 
+    //
+    // positions of last start and end
+    //
+    WORD m_StartX;
+    WORD m_StartY;
+    WORD m_EndX;
+    WORD m_EndY;
+
     //
     // flag to show or hide map on print
     //
@@ -163,5 +518,70 @@ namespace ubistar
     // indicates status of search
     //
     BOOL m_PathFound;
+
+    //
+    // flag to use expansion kernel
+    //
+    BOOL m_UseKernel;
+
+    //
+    // amount of expanded cells in last search
+    //
+    size_t m_Expansions;
+
+    //
+    // amount of heap allocations in last search
+    //
+    size_t m_Allocations;
+
+    //
+    // arenas of queries
+    //
+    QueryContext m_Context;
+
+    //
+    // kernel search state, indexed as World padded grid
+    //
+    std::vector<FLOAT> m_G;
+    std::vector<DWORD> m_Parents;
+
+    //
+    // index of goal per padded grid cell (-1 if cell is not a goal)
+    //
+    std::vector<INT> m_GoalSlots;
+
+    //
+    // multi goal results
+    //
+    size_t m_Goal;
+    std::vector<DOUBLE> m_GoalCosts;
+
+    //
+    // chunked search state, reached cells by y * cols + x
+    //
+    std::unordered_map<DWORD64, SparseCell> m_Sparse;
+
+    //
+    // tiles loaded by chunked world while last search
+    //
+    size_t m_TileFaults;
+    size_t m_TilePrefetches;
+
+    //
+    // profiler of search phases, not owned (nullptr if not profiled)
+    //
+    PhaseProfiler* m_Profiler;
+
+    //
+    // stop condition, cancel flag is not owned, and how the last search ended
+    //
+    const std::atomic<BOOL>* m_Cancelled;
+    std::chrono::steady_clock::time_point m_Deadline;
+    SEARCH_STATUS m_Status;
+
+    //
+    // expansions between checks of stop condition
+    //
+    static constexpr size_t STOP_CHECK_INTERVAL = 256;
   };
 }
\ No newline at end of file
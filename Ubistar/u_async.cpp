@@ -0,0 +1,161 @@
+/*!
+ *  \brief     Asynchronous queries impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_async.h"
+
+#include <algorithm>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  AsyncPathFinder class impl
+ ***********************************************/
+
+AsyncPathFinder::AsyncPathFinder(const SearcherFactory& factory, size_t threads)
+  : m_Stopping(false)
+{
+  if (!threads) threads = max(thread::hardware_concurrency(), 1u);
+
+  // searchers are ready before any thread may take a query
+  for (size_t i = 0; i < threads; i++) m_Searchers.push_back(factory());
+  m_Running.resize(threads);
+
+  for (size_t i = 0; i < threads; i++) m_Threads.emplace_back(&AsyncPathFinder::Work, this, i);
+}
+
+AsyncPathFinder::~AsyncPathFinder()
+{
+  {
+    lock_guard<mutex> lock(m_Mutex);
+    m_Stopping = true;
+
+    // queued queries are answered as cancelled, running ones stop at next check
+    for (auto& query : m_Queue) query.Cancelled->store(true, memory_order_relaxed);
+
+    for (auto& running : m_Running)
+    {
+      if (running) running->store(true, memory_order_relaxed);
+    }
+  }
+
+  m_Submitted.notify_all();
+
+  for (auto& thread : m_Threads) thread.join();
+}
+
+QueryHandle AsyncPathFinder::Submit(WORD startX, WORD startY, WORD endX, WORD endY,
+  std::chrono::steady_clock::time_point deadline)
+{
+  auto cancelled = make_shared<atomic<BOOL>>(false);
+  future<AsyncResult> answer;
+
+  {
+    lock_guard<mutex> lock(m_Mutex);
+
+    m_Queue.push_back({ startX, startY, endX, endY, steady_clock::now(), deadline, cancelled, {} });
+    answer = m_Queue.back().Answer.get_future();
+
+    // pool is stopping, nobody may take it later
+    if (m_Stopping) cancelled->store(true, memory_order_relaxed);
+  }
+
+  m_Submitted.notify_one();
+
+  return QueryHandle(move(answer), move(cancelled));
+}
+
+size_t AsyncPathFinder::GetQueuedCount() const
+{
+  lock_guard<mutex> lock(m_Mutex);
+  return m_Queue.size();
+}
+
+VOID AsyncPathFinder::Work(size_t worker)
+{
+  auto& pathFinder = *m_Searchers[worker];
+
+  while (true)
+  {
+    QueuedQuery query;
+
+    {
+      unique_lock<mutex> lock(m_Mutex);
+      m_Submitted.wait(lock, [this]() { return m_Stopping || !m_Queue.empty(); });
+
+      // queue is drained even when stopping, every future gets its answer
+      if (m_Queue.empty()) return;
+
+      query = move(m_Queue.front());
+      m_Queue.pop_front();
+      m_Running[worker] = query.Cancelled;
+    }
+
+    AsyncResult result = {};
+    exception_ptr error;
+
+    // failed search is rethrown by future, worker goes on with next query
+    try
+    {
+      result = Answer(pathFinder, query);
+    }
+    catch (...)
+    {
+      error = current_exception();
+    }
+
+    {
+      lock_guard<mutex> lock(m_Mutex);
+      m_Running[worker] = nullptr;
+    }
+
+    if (error) query.Answer.set_exception(error);
+    else query.Answer.set_value(move(result));
+  }
+}
+
+AsyncResult AsyncPathFinder::Answer(AStar& pathFinder, QueuedQuery& query)
+{
+  AsyncResult result = {};
+  result.Status = SEARCH_STATUS::COMPLETED;
+
+  // stale query is not searched at all
+  if (query.Cancelled->load(memory_order_relaxed))
+  {
+    result.Status = SEARCH_STATUS::CANCELLED;
+  }
+  else if (steady_clock::now() >= query.Deadline)
+  {
+    result.Status = SEARCH_STATUS::EXPIRED;
+  }
+  else if (query.StartX < pathFinder.GetMapCols() && query.StartY < pathFinder.GetMapRows() &&
+    query.EndX < pathFinder.GetMapCols() && query.EndY < pathFinder.GetMapRows())
+  {
+    pathFinder.SetStopCondition(query.Cancelled.get(), query.Deadline);
+    pathFinder.FindPath(query.StartX, query.StartY, query.EndX, query.EndY);
+    pathFinder.SetStopCondition(nullptr, steady_clock::time_point::max());
+
+    result.Status = pathFinder.GetLastStatus();
+    result.Found = pathFinder.IsLastFound();
+    result.Cost = pathFinder.GetLastCost();
+    result.Expansions = pathFinder.GetLastExpansions();
+    result.Duration = pathFinder.GetLastDuration();
+    result.Result = pathFinder.GetLastPath();
+  }
+
+  result.Latency = duration_cast<microseconds>(steady_clock::now() - query.Submitted).count() / 1000.0;
+
+  return result;
+}
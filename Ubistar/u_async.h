@@ -0,0 +1,251 @@
+#pragma once
+
+/*!
+ *  \brief     Asynchronous queries
+ *  \details   Background searchers answer queries through futures,
+ *             queries may be cancelled or given a deadline
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_astar.h"
+
+#include <Windows.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Answer of async query
+  */
+  struct AsyncResult
+  {
+    //
+    // how search ended, cancelled or expired query may not be searched at all
+    //
+    SEARCH_STATUS Status;
+
+    //
+    // search outputs, same as AStar getters give
+    //
+    BOOL Found;
+    DOUBLE Cost;
+    size_t Expansions;
+    DOUBLE Duration;
+    Path Result;
+
+    //
+    // milliseconds from submit till answer, including time in queue
+    //
+    DOUBLE Latency;
+  };
+
+  /*!
+  *  Handle of submitted query, answer comes through its future
+  */
+  class QueryHandle
+  {
+  public:
+
+    /*!
+    *  ctor, handles are made by AsyncPathFinder
+    *  \param future future of answer
+    *  \param cancelled cancel flag shared with searcher
+    */
+    QueryHandle(std::future<AsyncResult> future, std::shared_ptr<std::atomic<BOOL>> cancelled)
+      : m_Future(std::move(future)), m_Cancelled(std::move(cancelled)) {}
+
+    /*!
+    *  dtor, dropped handle cancels its query, nobody waits for the answer
+    */
+    ~QueryHandle() { Cancel(); }
+
+    /*!
+    *  handle is moved only, future can not be copied
+    */
+    QueryHandle(QueryHandle&&) = default;
+
+    /*!
+    *  query of replaced handle is cancelled, same as when handle is dropped
+    */
+    QueryHandle& operator=(QueryHandle&& r)
+    {
+      if (this != &r)
+      {
+        Cancel();
+        m_Future = std::move(r.m_Future);
+        m_Cancelled = std::move(r.m_Cancelled);
+      }
+
+      return *this;
+    }
+
+    /*!
+    *  asks to stop, queued query is not searched, running one stops
+    *  within few expansions, answer comes with CANCELLED status then.
+    *  Answered query is not changed, moved from handle does nothing
+    */
+    VOID Cancel()
+    {
+      if (m_Cancelled) m_Cancelled->store(true, std::memory_order_relaxed);
+    }
+
+    /*!
+    *  \return true if answer came, Get will not wait then
+    */
+    BOOL IsReady() const { return m_Future.wait_for(std::chrono::seconds::zero()) == std::future_status::ready; }
+
+    /*!
+    *  waits for answer, may be called only once
+    *  \return answer
+    *
+    *  \details rethrows exception search failed with (e.g. bad_alloc)
+    */
+    AsyncResult Get() { return m_Future.get(); }
+
+    /*!
+    *  \return future of answer, e.g. to wait with timeout
+    */
+    std::future<AsyncResult>& GetFuture() { return m_Future; }
+
+  private:
+
+    //
+    // answer
+    //
+    std::future<AsyncResult> m_Future;
+
+    //
+    // flag searcher checks while query goes
+    //
+    std::shared_ptr<std::atomic<BOOL>> m_Cancelled;
+  };
+
+  /*!
+  *  Pool of threads, each with its own searcher, taking queries in submit
+  *  order. Searchers check cancel flag and deadline of query inside
+  *  expansion loop, so abandoned queries stop using CPU
+  */
+  class AsyncPathFinder
+  {
+  public:
+
+    //
+    // makes searcher of one thread, all of them have to search the same map
+    //
+    using SearcherFactory = std::function<std::unique_ptr<AStar>()>;
+
+    /*!
+    *  ctor, searchers are made here on calling thread, then threads start
+    *  \param factory makes searcher per thread
+    *  \param threads amount of threads, 0 to use all cores
+    */
+    AsyncPathFinder(const SearcherFactory& factory, size_t threads = 0);
+
+    /*!
+    *  dtor, queued and running queries are cancelled, threads are joined
+    */
+    ~AsyncPathFinder();
+
+    /*!
+    *  Queues query, it never blocks on search
+    *  \param startX x coordinate (col) of start pos
+    *  \param startY y coordinate (row) of start pos
+    *  \param endX x coordinate (col) of end pos
+    *  \param endY y coordinate (row) of end pos
+    *  \param deadline time to give up at, query still in queue by then is not
+    *                  searched (time_point::max() for no deadline)
+    *  \return handle of query
+    *
+    *  \details positions out of the map give answer with path not found
+    */
+    QueryHandle Submit(WORD startX, WORD startY, WORD endX, WORD endY,
+      std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    /*!
+    *  \return amount of threads
+    */
+    size_t GetThreadsCount() const { return m_Threads.size(); }
+
+    /*!
+    *  \return amount of queries waiting for a thread
+    */
+    size_t GetQueuedCount() const;
+
+  private:
+
+    /*!
+    *  query waiting in queue
+    */
+    struct QueuedQuery
+    {
+      WORD StartX;
+      WORD StartY;
+      WORD EndX;
+      WORD EndY;
+      std::chrono::steady_clock::time_point Submitted;
+      std::chrono::steady_clock::time_point Deadline;
+      std::shared_ptr<std::atomic<BOOL>> Cancelled;
+      std::promise<AsyncResult> Answer;
+    };
+
+    /*!
+    *  loop of one thread, it takes queries until pool stops
+    *  \param worker index of thread and its searcher
+    */
+    VOID Work(size_t worker);
+
+    /*!
+    *  searches one query
+    *  \param pathFinder searcher of calling thread
+    *  \param query query to answer
+    *  \return answer
+    */
+    static AsyncResult Answer(AStar& pathFinder, QueuedQuery& query);
+
+    //
+    // searcher per thread
+    //
+    std::vector<std::unique_ptr<AStar>> m_Searchers;
+
+    //
+    // cancel flag of query each thread runs (nullptr if thread waits),
+    // pool cancels them when it stops
+    //
+    std::vector<std::shared_ptr<std::atomic<BOOL>>> m_Running;
+
+    //
+    // queries in submit order
+    //
+    std::deque<QueuedQuery> m_Queue;
+
+    //
+    // guards queue, running flags and stop flag
+    //
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_Submitted;
+    BOOL m_Stopping;
+
+    //
+    // threads, started last in ctor
+    //
+    std::vector<std::thread> m_Threads;
+  };
+}
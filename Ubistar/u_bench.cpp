@@ -0,0 +1,939 @@
+/*!
+ *  \brief     Benchmark mode impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_bench.h"
+#include "u_astar.h"
+#include "u_ch.h"
+#include "u_cpd.h"
+#include "u_subgoal.h"
+#include "u_generator.h"
+#include "u_async.h"
+#include "u_agents.h"
+
+#include <shlwapi.h>
+#include <psapi.h>
+#include <string>
+#include <memory>
+#include <random>
+#include <vector>
+#include <tuple>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <sstream>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// just to shorten
+using Query = tuple<WORD, WORD, WORD, WORD>;
+
+/*!
+*  One set of search settings to measure
+*/
+struct BenchMode
+{
+  const CHAR* Name;
+  CELL_LAYOUT Layout;
+  BOOL UseKernel;
+};
+
+/************************************************
+ *  Functions impl
+ ***********************************************/
+
+/*!
+*  Costs from one start to many goals, found by FindPath per goal
+*  and by one multi goal search
+*  \param mapPath path to file with map
+*  \param mapRows amount of rows in map
+*  \param mapCols amount of cols in map
+*  \param generator source of random positions
+*  \return 0 in success, or error code
+*/
+int RunGoalsBenchmark(const basic_string<TCHAR>& mapPath, WORD mapRows, WORD mapCols, mt19937& generator)
+{
+  constexpr size_t GOALS_AMOUNT = 50;
+  constexpr DOUBLE COST_TOLERANCE = 0.001;
+
+  uniform_int_distribution<INT> xDistribution(0, mapCols - 1);
+  uniform_int_distribution<INT> yDistribution(0, mapRows - 1);
+
+  auto random = [&]() -> Position
+  {
+    return { static_cast<WORD>(xDistribution(generator)), static_cast<WORD>(yDistribution(generator)) };
+  };
+
+  unique_ptr<AStar> pathFinder = make_unique<AStar>(mapPath, mapRows, mapCols, false);
+
+  auto start = random();
+  vector<Position> goals(GOALS_AMOUNT);
+  for (auto& goal : goals) goal = random();
+
+  // one search per goal, the way it was done before
+  vector<DOUBLE> costs(goals.size(), -1.0);
+  DOUBLE perGoalDuration = 0;
+  DOUBLE nearestCost = -1.0;
+
+  for (size_t i = 0; i < goals.size(); i++)
+  {
+    if (pathFinder->FindPath(start.X, start.Y, goals[i].X, goals[i].Y))
+    {
+      costs[i] = pathFinder->GetLastCost();
+      if (nearestCost < 0 || costs[i] < nearestCost) nearestCost = costs[i];
+    }
+
+    perGoalDuration += pathFinder->GetLastDuration();
+  }
+
+  size_t differences = 0;
+
+  pathFinder->FindCostsToGoals(start.X, start.Y, goals);
+  auto costsDuration = pathFinder->GetLastDuration();
+
+  for (size_t i = 0; i < goals.size(); i++)
+  {
+    if (abs(costs[i] - pathFinder->GetLastGoalCosts()[i]) > COST_TOLERANCE) differences++;
+  }
+
+  pathFinder->FindNearestGoal(start.X, start.Y, goals);
+  auto nearestDuration = pathFinder->GetLastDuration();
+
+  if (abs(nearestCost - (pathFinder->IsLastFound() ? pathFinder->GetLastCost() : -1.0)) > COST_TOLERANCE)
+  {
+    differences++;
+  }
+
+  cout << endl;
+  cout << "Mode: goals (" << goals.size() << " goals)" << endl;
+  cout << "FindPath per goal: " << perGoalDuration << " ms" << endl;
+  cout << "Costs to all goals: " << costsDuration << " ms" << endl;
+  cout << "Nearest goal: " << nearestDuration << " ms" << endl;
+  cout << "Cost differences: " << differences << endl;
+
+  return 0;
+}
+
+/*!
+*  Contraction hierarchy against kernel A* on the same queries
+*  \param mapPath path to file with map
+*  \param mapRows amount of rows in map
+*  \param mapCols amount of cols in map
+*  \param queries queries to solve
+*  \return 0 in success, or error code
+*/
+int RunHierarchyBenchmark(const basic_string<TCHAR>& mapPath, WORD mapRows, WORD mapCols, const vector<Query>& queries)
+{
+  // preprocessing is superlinear, huge maps would take the whole benchmark
+  constexpr size_t MAX_HIERARCHY_CELLS = 512 * 512;
+  constexpr DOUBLE COST_TOLERANCE = 0.001;
+
+  cout << endl;
+  cout << "Mode: contraction hierarchy" << endl;
+
+  if (static_cast<size_t>(mapRows) * mapCols > MAX_HIERARCHY_CELLS)
+  {
+    cout << "Skipped, map is too large" << endl;
+    return 0;
+  }
+
+  World world(mapPath, mapRows, mapCols);
+  ContractionHierarchy hierarchy(world);
+
+  unique_ptr<AStar> pathFinder = make_unique<AStar>(mapPath, mapRows, mapCols, false);
+
+  size_t found = 0;
+  size_t differences = 0;
+  size_t settled = 0;
+  DOUBLE astarDuration = 0;
+  DOUBLE hierarchyDuration = 0;
+
+  for (const auto& [startX, startY, endX, endY] : queries)
+  {
+    auto astarFound = pathFinder->FindPath(startX, startY, endX, endY).IsFound();
+    astarDuration += pathFinder->GetLastDuration();
+
+    auto hierarchyFound = hierarchy.FindPath(startX, startY, endX, endY);
+    hierarchyDuration += hierarchy.GetLastDuration();
+    settled += hierarchy.GetLastSettled();
+
+    if (hierarchyFound) found++;
+
+    if (astarFound != hierarchyFound || abs(pathFinder->GetLastCost() - hierarchy.GetLastCost()) > COST_TOLERANCE)
+    {
+      differences++;
+    }
+  }
+
+  auto count = max<size_t>(queries.size(), 1);
+
+  cout << "Preprocessing duration: " << hierarchy.GetBuildDuration() << " ms" << endl;
+  cout << "Shortcuts: " << hierarchy.GetShortcutsCount() << endl;
+  cout << "Index size: " << hierarchy.GetIndexSize() << " bytes" << endl;
+  cout << "Paths found: " << found << endl;
+  cout << "Settled per query: " << settled / count << endl;
+  cout << "A* per query: " << astarDuration / count << " ms" << endl;
+  cout << "Hierarchy per query: " << hierarchyDuration / count << " ms" << endl;
+
+  if (hierarchyDuration > 0)
+  {
+    cout << "Speedup: " << astarDuration / hierarchyDuration << endl;
+  }
+
+  cout << "Cost differences: " << differences << endl;
+
+  return 0;
+}
+
+/*!
+*  Compressed path database against kernel A* on the same queries
+*  \param mapPath path to file with map
+*  \param mapRows amount of rows in map
+*  \param mapCols amount of cols in map
+*  \param queries queries to solve
+*  \return 0 in success, or error code
+*/
+int RunDatabaseBenchmark(const basic_string<TCHAR>& mapPath, WORD mapRows, WORD mapCols, const vector<Query>& queries)
+{
+  // one search per source cell, build grows as square of map area
+  constexpr size_t MAX_DATABASE_CELLS = 256 * 256;
+  constexpr DOUBLE COST_TOLERANCE = 0.001;
+
+  cout << endl;
+  cout << "Mode: path database" << endl;
+
+  if (static_cast<size_t>(mapRows) * mapCols > MAX_DATABASE_CELLS)
+  {
+    cout << "Skipped, map is too large" << endl;
+    return 0;
+  }
+
+  World world(mapPath, mapRows, mapCols, CELL_LAYOUT::MORTON);
+  PathDatabase database(world);
+
+  unique_ptr<AStar> pathFinder = make_unique<AStar>(mapPath, mapRows, mapCols, false);
+
+  size_t found = 0;
+  size_t differences = 0;
+  DOUBLE astarDuration = 0;
+  DOUBLE databaseDuration = 0;
+
+  for (const auto& [startX, startY, endX, endY] : queries)
+  {
+    auto astarFound = pathFinder->FindPath(startX, startY, endX, endY).IsFound();
+    astarDuration += pathFinder->GetLastDuration();
+
+    auto databaseFound = database.FindPath(startX, startY, endX, endY);
+    databaseDuration += database.GetLastDuration();
+
+    if (databaseFound) found++;
+
+    if (astarFound != databaseFound || abs(pathFinder->GetLastCost() - database.GetLastCost()) > COST_TOLERANCE)
+    {
+      differences++;
+    }
+  }
+
+  auto count = max<size_t>(queries.size(), 1);
+
+  cout << "Build threads: " << database.GetThreadsCount() << endl;
+  cout << "Build duration: " << database.GetBuildDuration() << " ms" << endl;
+  cout << "Runs: " << database.GetRunsCount() << endl;
+  cout << "Size: " << database.GetSize() << " bytes" << endl;
+  cout << "Paths found: " << found << endl;
+  cout << "A* per query: " << astarDuration / count << " ms" << endl;
+  cout << "Database per query: " << databaseDuration / count << " ms" << endl;
+
+  if (databaseDuration > 0)
+  {
+    cout << "Speedup: " << astarDuration / databaseDuration << endl;
+  }
+
+  cout << "Cost differences: " << differences << endl;
+
+  return 0;
+}
+
+/*!
+*  Subgoal graph against kernel A* on the same queries
+*  \param mapPath path to file with map
+*  \param mapRows amount of rows in map
+*  \param mapCols amount of cols in map
+*  \param queries queries to solve
+*  \return 0 in success, or error code
+*/
+int RunSubgoalBenchmark(const basic_string<TCHAR>& mapPath, WORD mapRows, WORD mapCols, const vector<Query>& queries)
+{
+  constexpr DOUBLE COST_TOLERANCE = 0.001;
+
+  World world(mapPath, mapRows, mapCols);
+  SubgoalGraph graph(world);
+
+  unique_ptr<AStar> pathFinder = make_unique<AStar>(mapPath, mapRows, mapCols, false);
+
+  size_t found = 0;
+  size_t differences = 0;
+  size_t astarExpansions = 0;
+  size_t graphExpansions = 0;
+  DOUBLE astarDuration = 0;
+  DOUBLE graphDuration = 0;
+
+  for (const auto& [startX, startY, endX, endY] : queries)
+  {
+    auto astarFound = pathFinder->FindPath(startX, startY, endX, endY).IsFound();
+    astarDuration += pathFinder->GetLastDuration();
+    astarExpansions += pathFinder->GetLastExpansions();
+
+    auto graphFound = graph.FindPath(startX, startY, endX, endY);
+    graphDuration += graph.GetLastDuration();
+    graphExpansions += graph.GetLastExpansions();
+
+    if (graphFound) found++;
+
+    if (astarFound != graphFound || abs(pathFinder->GetLastCost() - graph.GetLastCost()) > COST_TOLERANCE)
+    {
+      differences++;
+    }
+  }
+
+  auto count = max<size_t>(queries.size(), 1);
+
+  cout << endl;
+  cout << "Mode: subgoal graph" << endl;
+  cout << "Build duration: " << graph.GetBuildDuration() << " ms" << endl;
+  cout << "Subgoals: " << graph.GetSubgoalsCount() << endl;
+  cout << "Edges: " << graph.GetEdgesCount() << endl;
+  cout << "Size: " << graph.GetSize() << " bytes" << endl;
+  cout << "Paths found: " << found << endl;
+  cout << "A* expansions per query: " << astarExpansions / count << endl;
+  cout << "Graph expansions per query: " << graphExpansions / count << endl;
+  cout << "A* per query: " << astarDuration / count << " ms" << endl;
+  cout << "Graph per query: " << graphDuration / count << " ms" << endl;
+
+  if (graphDuration > 0)
+  {
+    cout << "Speedup: " << astarDuration / graphDuration << endl;
+  }
+
+  cout << "Cost differences: " << differences << endl;
+
+  return 0;
+}
+
+/*!
+*  Same queries through async searchers: throughput against synchronous
+*  kernel, then with half of queries cancelled, then with deadline
+*  \param mapPath path to file with map
+*  \param mapRows amount of rows in map
+*  \param mapCols amount of cols in map
+*  \param queries queries to solve
+*  \return 0 in success, or error code
+*/
+int RunAsyncBenchmark(const basic_string<TCHAR>& mapPath, WORD mapRows, WORD mapCols, const vector<Query>& queries)
+{
+  constexpr DOUBLE COST_TOLERANCE = 0.001;
+
+  cout << endl;
+  cout << "Mode: async" << endl;
+
+  unique_ptr<AStar> pathFinder = make_unique<AStar>(mapPath, mapRows, mapCols, false);
+
+  vector<DOUBLE> costs(queries.size());
+  DOUBLE syncDuration = 0;
+
+  for (size_t i = 0; i < queries.size(); i++)
+  {
+    auto [startX, startY, endX, endY] = queries[i];
+
+    pathFinder->FindPath(startX, startY, endX, endY);
+    costs[i] = pathFinder->GetLastCost();
+    syncDuration += pathFinder->GetLastDuration();
+  }
+
+  AsyncPathFinder asyncFinder([&]() { return make_unique<AStar>(mapPath, mapRows, mapCols, false); });
+
+  vector<QueryHandle> handles;
+  handles.reserve(queries.size());
+
+  // submits all queries (or one by one, waiting for answer before next),
+  // then waits for all answers, returns wall time and counts answers per status
+  auto run = [&](steady_clock::duration budget, size_t cancelEvery, BOOL oneByOne, size_t statuses[], size_t& expansions)
+  {
+    auto start = steady_clock::now();
+
+    handles.clear();
+    for (const auto& [startX, startY, endX, endY] : queries)
+    {
+      auto deadline = budget == steady_clock::duration::max() ? steady_clock::time_point::max() : steady_clock::now() + budget;
+      handles.push_back(asyncFinder.Submit(startX, startY, endX, endY, deadline));
+
+      if (oneByOne) handles.back().GetFuture().wait();
+    }
+
+    for (size_t i = 0; cancelEvery && i < handles.size(); i += cancelEvery) handles[i].Cancel();
+
+    size_t differences = 0;
+    expansions = 0;
+
+    for (size_t i = 0; i < handles.size(); i++)
+    {
+      auto result = handles[i].Get();
+
+      statuses[static_cast<BYTE>(result.Status)]++;
+      expansions += result.Expansions;
+
+      if (result.Status == SEARCH_STATUS::COMPLETED && abs(result.Cost - costs[i]) > COST_TOLERANCE) differences++;
+    }
+
+    auto wall = duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.0;
+    return make_pair(wall, differences);
+  };
+
+  auto print = [](const size_t statuses[])
+  {
+    cout << "Completed: " << statuses[static_cast<BYTE>(SEARCH_STATUS::COMPLETED)]
+      << ", cancelled: " << statuses[static_cast<BYTE>(SEARCH_STATUS::CANCELLED)]
+      << ", expired: " << statuses[static_cast<BYTE>(SEARCH_STATUS::EXPIRED)] << endl;
+  };
+
+  size_t allExpansions = 0;
+  size_t statuses[3] = {};
+  auto [asyncDuration, differences] = run(steady_clock::duration::max(), 0, false, statuses, allExpansions);
+
+  cout << "Threads: " << asyncFinder.GetThreadsCount() << endl;
+  cout << "Sync duration: " << syncDuration << " ms" << endl;
+  cout << "Async wall duration: " << asyncDuration << " ms" << endl;
+  cout << "Cost differences: " << differences << endl;
+
+  // every second query is abandoned right after submit
+  size_t cancelledExpansions = 0;
+  size_t cancelledStatuses[3] = {};
+  run(steady_clock::duration::max(), 2, false, cancelledStatuses, cancelledExpansions);
+
+  cout << "Cancel every second: ";
+  print(cancelledStatuses);
+  cout << "Expansions: " << cancelledExpansions << " of " << allExpansions << endl;
+
+  // budget of mean sync query, queries are sent one by one so only searches
+  // longer than it expire
+  auto budget = duration_cast<steady_clock::duration>(duration<DOUBLE, milli>(syncDuration / max<size_t>(queries.size(), 1)));
+  size_t expiredExpansions = 0;
+  size_t expiredStatuses[3] = {};
+  run(budget, 0, true, expiredStatuses, expiredExpansions);
+
+  cout << "Deadline " << syncDuration / max<size_t>(queries.size(), 1) << " ms after submit: ";
+  print(expiredStatuses);
+  cout << "Expansions: " << expiredExpansions << " of " << allExpansions << endl;
+
+  return 0;
+}
+
+int ubistar::RunBenchmark(const int& argc, TCHAR* argv[])
+{
+  constexpr BYTE MIN_INPUT_AMOUNT = 3;
+  constexpr BYTE MAX_INPUT_AMOUNT = 7;
+
+  // costs closer than this are considered equal
+  constexpr DOUBLE COST_TOLERANCE = 0.001;
+
+  // original per direction search is the base for speedup
+  const BenchMode MODES[] =
+  {
+    { "directions", CELL_LAYOUT::ROW_MAJOR, false },
+    { "kernel", CELL_LAYOUT::ROW_MAJOR, true },
+    { "kernel", CELL_LAYOUT::TILED, true },
+    { "kernel", CELL_LAYOUT::MORTON, true }
+  };
+
+  basic_string<TCHAR> mapPath;
+  size_t queriesAmount = 1000;
+  UINT seed = 0;
+  WORD mapCols = 126;
+  WORD mapRows = 126;
+
+  try
+  {
+    if (argc < MIN_INPUT_AMOUNT || argc > MAX_INPUT_AMOUNT || argc == MAX_INPUT_AMOUNT - 1)
+    {
+      throw runtime_error("Amount of input args are wrong");
+    }
+
+    if (!PathFileExists(argv[2]))
+    {
+      throw runtime_error("Path to map file is wrong");
+    }
+
+    mapPath = argv[2];
+    if (argc > 3) queriesAmount = stoul(argv[3]);
+    if (argc > 4) seed = stoul(argv[4]);
+
+    if (argc == MAX_INPUT_AMOUNT)
+    {
+      auto cols = stoul(argv[5]);
+      auto rows = stoul(argv[6]);
+
+      // one tile border is added around the map, it still has to fit in WORD
+      if (cols == 0 || rows == 0 || cols > MAXWORD - 2 || rows > MAXWORD - 2)
+      {
+        throw runtime_error("Map size is out of range");
+      }
+
+      mapCols = static_cast<WORD>(cols);
+      mapRows = static_cast<WORD>(rows);
+    }
+
+    // World reads symbols one by one, other size would wrap rows wrongly
+    size_t fileCols = 0;
+    size_t fileRows = 0;
+
+    if (!World::ReadFileSize(mapPath, fileCols, fileRows) || fileCols != mapCols || fileRows != mapRows)
+    {
+      throw runtime_error("Map size does not match the file");
+    }
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return ERROR_INVALID_DATA;
+  }
+
+  // queries are generated once, so all modes solve the same set
+  mt19937 generator(seed);
+  uniform_int_distribution<INT> xDistribution(0, mapCols - 1);
+  uniform_int_distribution<INT> yDistribution(0, mapRows - 1);
+
+  vector<Query> queries(queriesAmount);
+  for (auto& query : queries)
+  {
+    query = { static_cast<WORD>(xDistribution(generator)), static_cast<WORD>(yDistribution(generator)),
+      static_cast<WORD>(xDistribution(generator)), static_cast<WORD>(yDistribution(generator)) };
+  }
+
+  cout << "Kernel: " << GetExpansionKernelName() << endl;
+  cout << "Map size: " << mapCols << " x " << mapRows << endl;
+  cout << "Queries: " << queries.size() << endl;
+
+  vector<DOUBLE> costs(queries.size());
+  DOUBLE baseRate = 0;
+
+  for (const auto& mode : MODES)
+  {
+    unique_ptr<AStar> pathFinder = make_unique<AStar>(mapPath, mapRows, mapCols, false, mode.Layout);
+    pathFinder->SetKernelEnabled(mode.UseKernel);
+
+    PhaseProfiler profiler;
+    pathFinder->SetProfiler(&profiler);
+
+    size_t expansions = 0;
+    size_t allocations = 0;
+    size_t found = 0;
+    size_t differences = 0;
+    DOUBLE duration = 0;
+
+    for (size_t i = 0; i < queries.size(); i++)
+    {
+      auto [startX, startY, endX, endY] = queries[i];
+
+      if (pathFinder->FindPath(startX, startY, endX, endY)) found++;
+
+      expansions += pathFinder->GetLastExpansions();
+      allocations += pathFinder->GetLastAllocations();
+      duration += pathFinder->GetLastDuration();
+
+      if (&mode == MODES)
+      {
+        costs[i] = pathFinder->GetLastCost();
+      }
+      else if (abs(costs[i] - pathFinder->GetLastCost()) > COST_TOLERANCE)
+      {
+        differences++;
+      }
+    }
+
+    auto rate = duration > 0 ? expansions / (duration / 1000.0) : 0;
+
+    cout << endl;
+    cout << "Mode: " << mode.Name << " (" << pathFinder->GetLayoutName() << ")" << endl;
+    cout << "Cells in memory: " << pathFinder->GetCellsInMemory() << endl;
+    cout << "Paths found: " << found << endl;
+    cout << "Expansions: " << expansions << endl;
+    cout << "Total duration: " << duration << " ms" << endl;
+    cout << "Expansions per second: " << static_cast<size_t>(rate) << endl;
+    cout << "Allocations in queries: " << allocations << endl;
+    profiler.Print(cout, "Phase ");
+
+    if (&mode == MODES)
+    {
+      baseRate = rate;
+      continue;
+    }
+
+    if (baseRate > 0)
+    {
+      cout << "Speedup: " << rate / baseRate << endl;
+    }
+
+    // directions mode does not reorder open list when g of queued cell improves,
+    // so it may return a bit more expensive path than kernel
+    cout << "Cost differences: " << differences << endl;
+  }
+
+  auto result = RunHierarchyBenchmark(mapPath, mapRows, mapCols, queries);
+  if (result) return result;
+
+  result = RunSubgoalBenchmark(mapPath, mapRows, mapCols, queries);
+  if (result) return result;
+
+  result = RunDatabaseBenchmark(mapPath, mapRows, mapCols, queries);
+  if (result) return result;
+
+  result = RunAsyncBenchmark(mapPath, mapRows, mapCols, queries);
+  if (result) return result;
+
+  return RunGoalsBenchmark(mapPath, mapRows, mapCols, generator);
+}
+
+/*!
+*  \return bytes in working set of process
+*/
+size_t GetWorkingSetSize()
+{
+  PROCESS_MEMORY_COUNTERS counters = {};
+  counters.cb = sizeof(counters);
+
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+
+  return counters.WorkingSetSize;
+}
+
+int ubistar::RunScalingBenchmark(const int& argc, TCHAR* argv[])
+{
+  constexpr BYTE MIN_INPUT_AMOUNT = 2;
+  constexpr BYTE MAX_INPUT_AMOUNT = 6;
+
+  // sizes go from this side, doubling
+  constexpr size_t MIN_SIDE = 128;
+
+  // generated map is written here, World loads it as any other map
+  const string SCALE_MAP_PATH = "ubistar_scale.txt";
+
+  const WORKLOAD WORKLOADS[] = { WORKLOAD::RANDOM, WORKLOAD::LONG_HAUL, WORKLOAD::UNREACHABLE };
+  constexpr BYTE WORKLOADS_COUNT = sizeof(WORKLOADS) / sizeof(WORKLOADS[0]);
+
+  // cache and TLB behaviour of layouts shows in time on maps above cache size
+  const CELL_LAYOUT LAYOUTS[] = { CELL_LAYOUT::ROW_MAJOR, CELL_LAYOUT::TILED, CELL_LAYOUT::MORTON };
+
+  GeneratorSettings settings = { MAP_STRUCTURE::NOISE, 0, 0.25, 0.15, 0.1 };
+  size_t queriesAmount = 100;
+  size_t maxSide = 1024;
+
+  try
+  {
+    if (argc < MIN_INPUT_AMOUNT || argc > MAX_INPUT_AMOUNT)
+    {
+      throw runtime_error("Amount of input args are wrong");
+    }
+
+    if (argc > 2 && !MapGenerator::ParseStructure(argv[2], settings.Structure))
+    {
+      throw runtime_error("Map structure is unknown");
+    }
+
+    if (argc > 3) settings.Seed = stoul(argv[3]);
+    if (argc > 4) queriesAmount = stoul(argv[4]);
+    if (argc > 5) maxSide = stoul(argv[5]);
+
+    // one tile border is added around the map, it still has to fit in WORD
+    if (maxSide < MIN_SIDE || maxSide > MAXWORD - 2)
+    {
+      throw runtime_error("Map size is out of range");
+    }
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return ERROR_INVALID_DATA;
+  }
+
+  cout << "Kernel: " << GetExpansionKernelName() << endl;
+  cout << "Structure: " << MapGenerator::GetStructureName(settings.Structure) << endl;
+  cout << "Queries per workload: " << queriesAmount << endl;
+
+  // one line per size and layout, printed together at the end
+  ostringstream curves;
+  curves << "Curve: side layout cells memory_kb";
+  for (auto workload : WORKLOADS) curves << ' ' << MapGenerator::GetWorkloadName(workload) << "_ms";
+  curves << " expansions_per_second" << '\n';
+
+  vector<GeneratedQuery> queries[WORKLOADS_COUNT];
+
+  for (size_t side = MIN_SIDE; side <= maxSide; side *= 2)
+  {
+    try
+    {
+      // water stays at default, unless maze can not go that low on this size
+      auto mapSettings = settings;
+      mapSettings.Water = max(settings.Water, MapGenerator::GetMinWaterShare(settings.Structure, side, side));
+
+      MapGenerator generator(side, side, mapSettings);
+
+      if (!generator.Write(basic_string<TCHAR>(SCALE_MAP_PATH.begin(), SCALE_MAP_PATH.end())))
+      {
+        throw runtime_error("Generated map can not be written");
+      }
+
+      // every layout solves the same queries
+      for (BYTE i = 0; i < WORKLOADS_COUNT; i++)
+      {
+        generator.GenerateQueries(WORKLOADS[i], queriesAmount, settings.Seed + i, queries[i]);
+      }
+
+      cout << endl;
+      cout << "Map size: " << side << " x " << side << endl;
+      cout << "Water share: " << generator.GetWaterShare() << endl;
+      cout << "Areas: " << generator.GetAreasCount() << endl;
+
+      for (auto layout : LAYOUTS)
+      {
+        DOUBLE msPerQuery[WORKLOADS_COUNT] = {};
+        size_t totalExpansions = 0;
+        DOUBLE totalDuration = 0;
+
+        // searcher and its arenas are what map size costs
+        auto workingSet = GetWorkingSetSize();
+
+        unique_ptr<AStar> pathFinder = make_unique<AStar>(basic_string<TCHAR>(SCALE_MAP_PATH.begin(), SCALE_MAP_PATH.end()),
+          static_cast<WORD>(side), static_cast<WORD>(side), false, layout);
+
+        cout << "Layout: " << pathFinder->GetLayoutName() << endl;
+
+        for (BYTE i = 0; i < WORKLOADS_COUNT; i++)
+        {
+          size_t found = 0;
+          size_t expansions = 0;
+          DOUBLE duration = 0;
+
+          for (const auto& [start, end] : queries[i])
+          {
+            if (pathFinder->FindPath(start.X, start.Y, end.X, end.Y)) found++;
+
+            expansions += pathFinder->GetLastExpansions();
+            duration += pathFinder->GetLastDuration();
+          }
+
+          auto count = max<size_t>(queries[i].size(), 1);
+          msPerQuery[i] = duration / count;
+          totalExpansions += expansions;
+          totalDuration += duration;
+
+          cout << "Workload " << MapGenerator::GetWorkloadName(WORKLOADS[i]) << ": queries " << queries[i].size()
+            << ", found " << found << ", ms per query " << msPerQuery[i]
+            << ", expansions per query " << expansions / count << endl;
+        }
+
+        // working set may shrink when memory of previous searcher is trimmed
+        auto current = GetWorkingSetSize();
+        auto memory = current > workingSet ? current - workingSet : 0;
+        auto cells = pathFinder->GetCellsInMemory();
+        auto rate = totalDuration > 0 ? static_cast<size_t>(totalExpansions / (totalDuration / 1000.0)) : 0;
+
+        cout << "Cells in memory: " << cells << endl;
+        cout << "Working set growth: " << memory / 1024 << " KB" << endl;
+        cout << "Expansions per second: " << rate << endl;
+
+        curves << "Curve: " << side << ' ' << pathFinder->GetLayoutName() << ' ' << cells << ' ' << memory / 1024;
+        for (auto ms : msPerQuery) curves << ' ' << ms;
+        curves << ' ' << rate << '\n';
+      }
+    }
+    catch (exception& e)
+    {
+      remove(SCALE_MAP_PATH.c_str());
+      cerr << e.what() << endl;
+      return ERROR_INVALID_DATA;
+    }
+
+    remove(SCALE_MAP_PATH.c_str());
+  }
+
+  cout << endl << curves.str();
+
+  return 0;
+}
+
+int ubistar::RunAgentsBenchmark(const int& argc, TCHAR* argv[])
+{
+  constexpr BYTE MIN_INPUT_AMOUNT = 3;
+  constexpr BYTE MAX_INPUT_AMOUNT = 8;
+
+  basic_string<TCHAR> mapPath;
+  size_t agentsAmount = 1000;
+  UINT seed = 0;
+  WORD window = 16;
+  WORD mapCols = 126;
+  WORD mapRows = 126;
+
+  unique_ptr<World> world;
+
+  try
+  {
+    if (argc < MIN_INPUT_AMOUNT || argc > MAX_INPUT_AMOUNT || argc == MAX_INPUT_AMOUNT - 1)
+    {
+      throw runtime_error("Amount of input args are wrong");
+    }
+
+    if (!PathFileExists(argv[2]))
+    {
+      throw runtime_error("Path to map file is wrong");
+    }
+
+    mapPath = argv[2];
+    if (argc > 3) agentsAmount = stoul(argv[3]);
+    if (argc > 4) seed = stoul(argv[4]);
+
+    if (argc > 5)
+    {
+      auto value = stoul(argv[5]);
+
+      if (value == 0 || value > MAXBYTE)
+      {
+        throw runtime_error("Window is out of range");
+      }
+
+      window = static_cast<WORD>(value);
+    }
+
+    if (argc == MAX_INPUT_AMOUNT)
+    {
+      auto cols = stoul(argv[6]);
+      auto rows = stoul(argv[7]);
+
+      // one tile border is added around the map, it still has to fit in WORD
+      if (cols == 0 || rows == 0 || cols > MAXWORD - 2 || rows > MAXWORD - 2)
+      {
+        throw runtime_error("Map size is out of range");
+      }
+
+      mapCols = static_cast<WORD>(cols);
+      mapRows = static_cast<WORD>(rows);
+    }
+
+    // World reads symbols one by one, other size would wrap rows wrongly
+    size_t fileCols = 0;
+    size_t fileRows = 0;
+
+    if (!World::ReadFileSize(mapPath, fileCols, fileRows) || fileCols != mapCols || fileRows != mapRows)
+    {
+      throw runtime_error("Map size does not match the file");
+    }
+
+    world = make_unique<World>(mapPath, mapRows, mapCols);
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return ERROR_INVALID_DATA;
+  }
+
+  // agents never share start or goal, such collisions can not be avoided
+  vector<Position> passable;
+  const auto* costs = world->GetPaddedCosts();
+
+  for (WORD y = 0; y < mapRows; y++)
+  {
+    for (WORD x = 0; x < mapCols; x++)
+    {
+      if (costs[world->GetPaddedIndex(x, y)] > 0.0f) passable.push_back({ x, y });
+    }
+  }
+
+  agentsAmount = min(agentsAmount, passable.size());
+
+  mt19937 generator(seed);
+  vector<AgentRequest> agents(agentsAmount);
+
+  shuffle(passable.begin(), passable.end(), generator);
+  for (size_t i = 0; i < agentsAmount; i++) agents[i].Start = passable[i];
+
+  shuffle(passable.begin(), passable.end(), generator);
+  for (size_t i = 0; i < agentsAmount; i++) agents[i].Goal = passable[i];
+
+  cout << "Map size: " << mapCols << " x " << mapRows << endl;
+  cout << "Agents: " << agents.size() << endl;
+  cout << "Window: " << window << endl;
+
+  CooperativePlanner planner(*world, window);
+  size_t independentConflicts = 0;
+
+  for (BOOL cooperative : { false, true })
+  {
+    planner.SetCooperative(cooperative);
+
+    auto reached = planner.Plan(agents);
+    const auto& plans = planner.GetPlans();
+
+    DOUBLE cost = 0;
+    DOUBLE maxDuration = 0;
+    size_t expansions = 0;
+    size_t blocked = 0;
+    size_t steps = 0;
+
+    for (const auto& plan : plans)
+    {
+      cost += plan.Cost;
+      maxDuration = max(maxDuration, plan.Duration);
+      expansions += plan.Expansions;
+      blocked += plan.Blocked;
+      steps = max(steps, plan.Steps.size());
+    }
+
+    auto conflicts = planner.GetConflicts();
+    auto count = max<size_t>(plans.size(), 1);
+
+    cout << endl;
+    cout << "Mode: " << (cooperative ? "cooperative" : "independent") << endl;
+    cout << "Agents reached goals: " << reached << endl;
+    cout << "Rounds: " << planner.GetRounds() << endl;
+    cout << "Time steps: " << (steps ? steps - 1 : 0) << endl;
+    cout << "Sum of costs: " << cost << endl;
+    cout << "Total duration: " << planner.GetDuration() << " ms" << endl;
+    cout << "Planning per agent: " << planner.GetDuration() / count << " ms, max " << maxDuration << " ms" << endl;
+    cout << "Expansions per agent: " << expansions / count << endl;
+    cout << "Blocked moves: " << blocked << endl;
+    cout << "Conflicts: " << conflicts << endl;
+
+    if (!cooperative)
+    {
+      independentConflicts = conflicts;
+      continue;
+    }
+
+    cout << "Conflicts avoided: " << (independentConflicts > conflicts ? independentConflicts - conflicts : 0) << endl;
+
+    // starts are distinct, so any collision left is a planner bug
+    if (conflicts)
+    {
+      cerr << "Cooperative plans collide" << endl;
+      return ERROR_INVALID_DATA;
+    }
+  }
+
+  return 0;
+}
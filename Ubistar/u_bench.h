@@ -0,0 +1,66 @@
+#pragma once
+
+/*!
+ *  \brief     Benchmark mode
+ *  \details   Solves same random queries with different search settings
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include <Windows.h>
+#include <tchar.h>
+
+  /************************************************
+   *  decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Benchmark mode, same random queries are solved with original per direction
+  *  expansion and with expansion kernel over every cell layout
+  *  \param argc from 3 to 7
+  *  \param argv contains the following pattern:
+  *              astar.exe bench MapFileName [queries] [seed] [cols rows]
+  *              where MapFileName - path to file with map
+  *                    queries - amount of random queries (1000 by default)
+  *                    seed - seed for query generator (0 by default)
+  *                    cols rows - map size (126 x 126 by default)
+  *  \return 0 in success, or error code
+  */
+  int RunBenchmark(const int& argc, TCHAR* argv[]);
+
+  /*!
+  *  Scaling mode, generated maps of growing size are solved with generated
+  *  workloads, time and memory per size are printed as curves
+  *  \param argc from 2 to 6
+  *  \param argv contains the following pattern:
+  *              astar.exe scale [structure] [seed] [queries] [maxSide]
+  *              where structure - noise, maze or rooms (noise by default)
+  *                    seed - seed for maps and queries (0 by default)
+  *                    queries - amount of queries per workload (100 by default)
+  *                    maxSide - side of the largest map (1024 by default)
+  *  \return 0 in success, or error code
+  */
+  int RunScalingBenchmark(const int& argc, TCHAR* argv[]);
+
+  /*!
+  *  Multi-agent mode, random agents are planned one by one as if each is
+  *  alone and then cooperatively with reservation table, collisions of both
+  *  and planning time per agent are printed
+  *  \param argc from 3 to 8
+  *  \param argv contains the following pattern:
+  *              astar.exe agents MapFileName [agents] [seed] [window] [cols rows]
+  *              where MapFileName - path to file with map
+  *                    agents - amount of agents (1000 by default)
+  *                    seed - seed for starts and goals (0 by default)
+  *                    window - time steps planned per round (16 by default)
+  *                    cols rows - map size (126 x 126 by default)
+  *  \return 0 in success, or error code
+  */
+  int RunAgentsBenchmark(const int& argc, TCHAR* argv[]);
+}
@@ -0,0 +1,538 @@
+/*!
+ *  \brief     Contraction hierarchy impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_ch.h"
+
+#include <chrono>
+#include <queue>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// cell is blocked, edge is not a shortcut
+constexpr DWORD NO_NODE = MAXDWORD;
+
+// distance of nodes search did not reach yet
+constexpr FLOAT UNREACHED = numeric_limits<FLOAT>::max();
+
+// witness search gives up after this many settled nodes and shortcut is added,
+// it costs some extra shortcuts but keeps preprocessing fast
+constexpr size_t WITNESS_SETTLE_LIMIT = 256;
+
+// priority only estimates shortcuts, so much shorter search is enough there
+constexpr size_t SIMULATION_SETTLE_LIMIT = 16;
+
+// both searches of a query
+constexpr BYTE FORWARD = 0;
+constexpr BYTE BACKWARD = 1;
+
+// just to shorten, min heap by distance
+using HeapItem = pair<FLOAT, DWORD>;
+using MinHeap = priority_queue<HeapItem, vector<HeapItem>, greater<HeapItem>>;
+
+/************************************************
+ *  ContractionHierarchy class impl
+ ***********************************************/
+
+ContractionHierarchy::ContractionHierarchy(const World& world)
+  : m_Cols(world.GetCols()), m_Rows(world.GetRows()),
+  m_Cost(0), m_Duration(0), m_BuildDuration(0), m_Settled(0), m_Shortcuts(0)
+{
+  auto start = high_resolution_clock::now();
+
+  const auto* costs = world.GetPaddedCosts();
+
+  // nodes are passable cells only
+  m_NodeByCell.resize(m_Cols * m_Rows, NO_NODE);
+
+  for (size_t y = 0; y < m_Rows; y++)
+  {
+    for (size_t x = 0; x < m_Cols; x++)
+    {
+      auto cost = costs[world.GetPaddedIndex(static_cast<WORD>(x), static_cast<WORD>(y))];
+      if (cost <= 0.0f) continue;
+
+      m_NodeByCell[y * m_Cols + x] = static_cast<DWORD>(m_Positions.size());
+      m_Positions.push_back({ static_cast<WORD>(x), static_cast<WORD>(y) });
+      m_TerrainCosts.push_back(cost);
+    }
+  }
+
+  auto nodes = m_Positions.size();
+  const auto diagonal = sqrtf(2.0f);
+
+  m_Out.resize(nodes);
+  m_In.resize(nodes);
+
+  for (DWORD node = 0; node < nodes; node++)
+  {
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      INT x = m_Positions[node].X + DIRECTION_DX[i];
+      INT y = m_Positions[node].Y + DIRECTION_DY[i];
+
+      if (x < 0 || y < 0 || x >= static_cast<INT>(m_Cols) || y >= static_cast<INT>(m_Rows)) continue;
+
+      auto neighbour = m_NodeByCell[y * m_Cols + x];
+      if (neighbour == NO_NODE) continue;
+
+      // same as search does: cost of cell stepped on times length of step
+      auto cost = m_TerrainCosts[neighbour] * (i < 4 ? 1.0f : diagonal);
+
+      m_Out[node].push_back({ neighbour, cost, NO_NODE });
+      m_In[neighbour].push_back({ node, cost, NO_NODE });
+    }
+  }
+
+  m_WitnessDist.resize(nodes, UNREACHED);
+  m_WitnessTarget.resize(nodes, false);
+
+  // edge difference plus contracted neighbours and level, so contraction spreads
+  // over the map and hierarchy stays shallow
+  vector<DWORD> contractedNeighbours(nodes, 0);
+  vector<DWORD> levels(nodes, 0);
+  vector<DWORD> ranks(nodes, 0);
+
+  auto priority = [&](DWORD node) -> INT
+  {
+    auto degree = static_cast<INT>(m_Out[node].size() + m_In[node].size());
+
+    return 2 * (static_cast<INT>(Contract(node, true)) - degree)
+      + static_cast<INT>(contractedNeighbours[node]) + static_cast<INT>(levels[node]);
+  };
+
+  using Candidate = pair<INT, DWORD>;
+  priority_queue<Candidate, vector<Candidate>, greater<Candidate>> queue;
+
+  for (DWORD node = 0; node < nodes; node++)
+  {
+    queue.push({ priority(node), node });
+  }
+
+  DWORD rank = 0;
+
+  while (!queue.empty())
+  {
+    auto node = queue.top().second;
+    queue.pop();
+
+    // lazy update: priority may be outdated since neighbours were contracted
+    auto current = priority(node);
+    if (!queue.empty() && current > queue.top().first)
+    {
+      queue.push({ current, node });
+      continue;
+    }
+
+    m_Shortcuts += Contract(node, false);
+    ranks[node] = rank++;
+
+    // node leaves the remaining graph, its own lists are final:
+    // everything they point to is contracted later, so ranked higher
+    for (const auto& edge : m_Out[node])
+    {
+      auto& in = m_In[edge.Node];
+      in.erase(find_if(in.begin(), in.end(), [node](const Edge& e) { return e.Node == node; }));
+    }
+
+    for (const auto& edge : m_In[node])
+    {
+      auto& out = m_Out[edge.Node];
+      out.erase(find_if(out.begin(), out.end(), [node](const Edge& e) { return e.Node == node; }));
+    }
+
+    for (const auto& edges : { &m_Out[node], &m_In[node] })
+    {
+      for (const auto& edge : *edges)
+      {
+        contractedNeighbours[edge.Node]++;
+        levels[edge.Node] = max(levels[edge.Node], levels[node] + 1);
+      }
+    }
+  }
+
+  // nodes are renumbered by rank, highest first, so the top of hierarchy
+  // which every query goes through lies close in memory
+  vector<DWORD> slots(nodes);
+  vector<Position> positions(nodes);
+  vector<FLOAT> terrainCosts(nodes);
+
+  for (DWORD node = 0; node < nodes; node++)
+  {
+    slots[node] = static_cast<DWORD>(nodes - 1 - ranks[node]);
+    positions[slots[node]] = m_Positions[node];
+    terrainCosts[slots[node]] = m_TerrainCosts[node];
+  }
+
+  for (auto& node : m_NodeByCell)
+  {
+    if (node != NO_NODE) node = slots[node];
+  }
+
+  m_Positions.swap(positions);
+  m_TerrainCosts.swap(terrainCosts);
+
+  vector<DWORD> nodeBySlot(nodes);
+  for (DWORD node = 0; node < nodes; node++) nodeBySlot[slots[node]] = node;
+
+  // query graph in CSR: edges up in rank for forward search
+  // and edges coming down from higher ranks for backward one
+  m_UpOffsets.resize(nodes + 1, 0);
+  m_DownOffsets.resize(nodes + 1, 0);
+
+  auto renumbered = [&](Edge edge) -> Edge
+  {
+    return { slots[edge.Node], edge.Cost, edge.Middle == NO_NODE ? NO_NODE : slots[edge.Middle] };
+  };
+
+  for (DWORD slot = 0; slot < nodes; slot++)
+  {
+    auto node = nodeBySlot[slot];
+
+    m_UpOffsets[slot] = static_cast<DWORD>(m_Up.size());
+    for (const auto& edge : m_Out[node]) m_Up.push_back(renumbered(edge));
+
+    m_DownOffsets[slot] = static_cast<DWORD>(m_Down.size());
+    for (const auto& edge : m_In[node]) m_Down.push_back(renumbered(edge));
+  }
+
+  m_UpOffsets[nodes] = static_cast<DWORD>(m_Up.size());
+  m_DownOffsets[nodes] = static_cast<DWORD>(m_Down.size());
+
+  // build graph is not needed anymore
+  vector<vector<Edge>>().swap(m_Out);
+  vector<vector<Edge>>().swap(m_In);
+  vector<FLOAT>().swap(m_WitnessDist);
+  vector<DWORD>().swap(m_WitnessTouched);
+  vector<BYTE>().swap(m_WitnessTarget);
+
+  for (BYTE direction : { FORWARD, BACKWARD })
+  {
+    m_Dist[direction].resize(nodes, UNREACHED);
+    m_Parent[direction].resize(nodes, NO_NODE);
+    m_ParentMiddle[direction].resize(nodes, NO_NODE);
+  }
+
+  auto end = high_resolution_clock::now();
+  m_BuildDuration = duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+size_t ContractionHierarchy::Contract(DWORD node, BOOL simulate)
+{
+  size_t shortcuts = 0;
+
+  // lists hold only nodes which are not contracted yet, shortcuts go between
+  // neighbours, so lists of the node itself stay untouched
+  const auto& incoming = m_In[node];
+  const auto& outgoing = m_Out[node];
+
+  // witness search may stop as soon as all of them are settled
+  for (const auto& out : outgoing) m_WitnessTarget[out.Node] = true;
+
+  for (const auto& in : incoming)
+  {
+    FLOAT longest = 0;
+    for (const auto& out : outgoing)
+    {
+      if (out.Node != in.Node) longest = max(longest, out.Cost);
+    }
+
+    if (longest <= 0) continue;
+
+    Witness(in.Node, node, in.Cost + longest, outgoing.size(),
+      simulate ? SIMULATION_SETTLE_LIMIT : WITNESS_SETTLE_LIMIT);
+
+    for (const auto& out : outgoing)
+    {
+      if (out.Node == in.Node) continue;
+
+      auto cost = in.Cost + out.Cost;
+
+      // there is a path around which is not longer
+      if (m_WitnessDist[out.Node] <= cost) continue;
+
+      shortcuts++;
+      if (!simulate) AddShortcut(in.Node, out.Node, cost, node);
+    }
+  }
+
+  for (const auto& out : outgoing) m_WitnessTarget[out.Node] = false;
+
+  return shortcuts;
+}
+
+VOID ContractionHierarchy::Witness(DWORD source, DWORD skip, FLOAT limit, size_t targets, size_t settleLimit)
+{
+  for (auto node : m_WitnessTouched) m_WitnessDist[node] = UNREACHED;
+  m_WitnessTouched.clear();
+
+  MinHeap heap;
+  m_WitnessDist[source] = 0;
+  m_WitnessTouched.push_back(source);
+  heap.push({ 0.0f, source });
+
+  size_t settled = 0;
+
+  while (!heap.empty() && settled < settleLimit)
+  {
+    auto [dist, node] = heap.top();
+    heap.pop();
+
+    if (dist > m_WitnessDist[node]) continue;
+    if (dist > limit) break;
+
+    settled++;
+
+    if (m_WitnessTarget[node] && !--targets) break;
+
+    for (const auto& edge : m_Out[node])
+    {
+      if (edge.Node == skip) continue;
+
+      auto next = dist + edge.Cost;
+      if (next >= m_WitnessDist[edge.Node]) continue;
+
+      if (m_WitnessDist[edge.Node] == UNREACHED) m_WitnessTouched.push_back(edge.Node);
+      m_WitnessDist[edge.Node] = next;
+      heap.push({ next, edge.Node });
+    }
+  }
+}
+
+VOID ContractionHierarchy::AddShortcut(DWORD from, DWORD to, FLOAT cost, DWORD middle)
+{
+  auto& out = m_Out[from];
+  auto existing = find_if(out.begin(), out.end(), [to](const Edge& edge) { return edge.Node == to; });
+
+  // pair of nodes keeps one edge, the cheapest
+  if (existing != out.end())
+  {
+    if (existing->Cost <= cost) return;
+
+    existing->Cost = cost;
+    existing->Middle = middle;
+
+    for (auto& in : m_In[to])
+    {
+      if (in.Node == from)
+      {
+        in.Cost = cost;
+        in.Middle = middle;
+        break;
+      }
+    }
+
+    return;
+  }
+
+  out.push_back({ to, cost, middle });
+  m_In[to].push_back({ from, cost, middle });
+}
+
+const ContractionHierarchy::Edge* ContractionHierarchy::FindEdge(const Edge* begin, const Edge* end, DWORD node)
+{
+  for (auto edge = begin; edge != end; edge++)
+  {
+    if (edge->Node == node) return edge;
+  }
+
+  return nullptr;
+}
+
+VOID ContractionHierarchy::Unpack(DWORD from, DWORD to, DWORD middle, std::vector<DWORD>& nodes) const
+{
+  if (middle == NO_NODE)
+  {
+    nodes.push_back(to);
+    return;
+  }
+
+  // middle is ranked below both ends, so both halves are stored at middle:
+  // from -> middle among edges coming down to it, middle -> to among edges going up
+  auto first = FindEdge(m_Down.data() + m_DownOffsets[middle], m_Down.data() + m_DownOffsets[middle + 1], from);
+  auto second = FindEdge(m_Up.data() + m_UpOffsets[middle], m_Up.data() + m_UpOffsets[middle + 1], to);
+
+  Unpack(from, middle, first->Middle, nodes);
+  Unpack(middle, to, second->Middle, nodes);
+}
+
+BOOL ContractionHierarchy::FindPath(WORD startX, WORD startY, WORD endX, WORD endY)
+{
+  auto start = high_resolution_clock::now();
+
+  m_Cost = 0;
+  m_Settled = 0;
+  m_Path.clear();
+
+  auto source = m_NodeByCell[static_cast<size_t>(startY) * m_Cols + startX];
+  auto target = m_NodeByCell[static_cast<size_t>(endY) * m_Cols + endX];
+
+  for (auto node : m_Touched)
+  {
+    m_Dist[FORWARD][node] = UNREACHED;
+    m_Dist[BACKWARD][node] = UNREACHED;
+  }
+  m_Touched.clear();
+
+  FLOAT best = UNREACHED;
+  DWORD meeting = NO_NODE;
+
+  if (source != NO_NODE && target != NO_NODE)
+  {
+    auto& heaps = m_Heaps;
+    heaps[FORWARD].clear();
+    heaps[BACKWARD].clear();
+
+    m_Dist[FORWARD][source] = 0;
+    m_Dist[BACKWARD][target] = 0;
+    m_Parent[FORWARD][source] = NO_NODE;
+    m_Parent[BACKWARD][target] = NO_NODE;
+    m_Touched.push_back(source);
+    m_Touched.push_back(target);
+    heaps[FORWARD].push_back({ 0.0f, source });
+    heaps[BACKWARD].push_back({ 0.0f, target });
+
+    for (;;)
+    {
+      // search is over when neither side can improve the best meeting
+      BOOL forward = !heaps[FORWARD].empty() && heaps[FORWARD].front().first < best;
+      BOOL backward = !heaps[BACKWARD].empty() && heaps[BACKWARD].front().first < best;
+
+      if (!forward && !backward) break;
+
+      // the side with the closer node goes first
+      BYTE direction = forward && (!backward || heaps[FORWARD].front().first <= heaps[BACKWARD].front().first)
+        ? FORWARD : BACKWARD;
+
+      auto& heap = heaps[direction];
+      auto& dist = m_Dist[direction];
+      pop_heap(heap.begin(), heap.end(), greater<HeapItem>());
+      auto [current, node] = heap.back();
+      heap.pop_back();
+
+      if (current > dist[node]) continue;
+
+      m_Settled++;
+
+      auto other = m_Dist[direction ^ 1][node];
+      if (other != UNREACHED && current + other < best)
+      {
+        best = current + other;
+        meeting = node;
+      }
+
+      const auto& edges = direction == FORWARD ? m_Up : m_Down;
+      const auto& offsets = direction == FORWARD ? m_UpOffsets : m_DownOffsets;
+
+      // stall on demand: higher node already reached reaches this one cheaper,
+      // so nothing found from here can be on the shortest path
+      const auto& opposite = direction == FORWARD ? m_Down : m_Up;
+      const auto& oppositeOffsets = direction == FORWARD ? m_DownOffsets : m_UpOffsets;
+      BOOL stalled = false;
+
+      for (auto i = oppositeOffsets[node]; i < oppositeOffsets[node + 1] && !stalled; i++)
+      {
+        const auto& edge = opposite[i];
+        stalled = dist[edge.Node] != UNREACHED && dist[edge.Node] + edge.Cost < current;
+      }
+
+      if (stalled) continue;
+
+      for (auto i = offsets[node]; i < offsets[node + 1]; i++)
+      {
+        const auto& edge = edges[i];
+        auto next = current + edge.Cost;
+
+        if (next >= dist[edge.Node]) continue;
+
+        if (m_Dist[FORWARD][edge.Node] == UNREACHED && m_Dist[BACKWARD][edge.Node] == UNREACHED)
+        {
+          m_Touched.push_back(edge.Node);
+        }
+
+        dist[edge.Node] = next;
+        m_Parent[direction][edge.Node] = node;
+        m_ParentMiddle[direction][edge.Node] = edge.Middle;
+        heap.push_back({ next, edge.Node });
+        push_heap(heap.begin(), heap.end(), greater<HeapItem>());
+      }
+    }
+  }
+
+  if (meeting != NO_NODE)
+  {
+    // up edges from source to meeting node, collected backwards
+    auto& upward = m_Scratch;
+    upward.clear();
+
+    for (auto node = meeting; node != source; node = m_Parent[FORWARD][node])
+    {
+      upward.push_back(node);
+    }
+
+    auto& nodes = m_PathNodes;
+    nodes.assign(1, source);
+    auto from = source;
+
+    for (auto it = upward.rbegin(); it != upward.rend(); it++)
+    {
+      Unpack(from, *it, m_ParentMiddle[FORWARD][*it], nodes);
+      from = *it;
+    }
+
+    // down edges from meeting node to target, parents of backward search point there
+    for (auto node = meeting; node != target; node = m_Parent[BACKWARD][node])
+    {
+      Unpack(node, m_Parent[BACKWARD][node], m_ParentMiddle[BACKWARD][node], nodes);
+    }
+
+    // exact cost is summed over cells, shortcut costs are rounded floats
+    const auto diagonal = sqrt(2.0);
+    m_Path.reserve(nodes.size());
+
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+      const auto& position = m_Positions[nodes[i]];
+      m_Path.push_back(position);
+
+      if (!i) continue;
+
+      const auto& previous = m_Positions[nodes[i - 1]];
+      BOOL straight = previous.X == position.X || previous.Y == position.Y;
+      m_Cost += m_TerrainCosts[nodes[i]] * (straight ? 1.0 : diagonal);
+    }
+  }
+
+  auto end = high_resolution_clock::now();
+  m_Duration = duration_cast<microseconds>(end - start).count() / 1000.0;
+
+  return meeting != NO_NODE;
+}
+
+size_t ContractionHierarchy::GetIndexSize() const
+{
+  return (m_Up.size() + m_Down.size()) * sizeof(Edge)
+    + (m_UpOffsets.size() + m_DownOffsets.size() + m_NodeByCell.size()) * sizeof(DWORD)
+    + m_Positions.size() * sizeof(Position)
+    + m_TerrainCosts.size() * sizeof(FLOAT);
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+/*!
+ *  \brief     Contraction hierarchy
+ *  \details   Preprocessed index over World for fast point to point queries
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_world.h"
+
+#include <Windows.h>
+#include <vector>
+#include <utility>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Every passable cell is a node, every move between 8-connected cells
+  *  is a directed edge which costs as terrain of destination times distance.
+  *  Nodes are contracted one by one (lowest edge difference first) and
+  *  shortcuts keep distances between remaining nodes. Query is bidirectional
+  *  Dijkstra which goes only to higher ranked nodes, shortcuts of found
+  *  path are unpacked back into cells
+  */
+  class ContractionHierarchy
+  {
+  public:
+
+    /*!
+    *  ctor, whole preprocessing runs here
+    *  \param world world to build hierarchy for, it is not kept
+    */
+    ContractionHierarchy(const World& world);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~ContractionHierarchy() = default;
+
+    /*!
+    *  Point to point query
+    *  \param startX x coordinate (col) of start pos
+    *  \param startY y coordinate (row) of start pos
+    *  \param endX x coordinate (col) of end pos
+    *  \param endY y coordinate (row) of end pos
+    *  \return true if path is found
+    */
+    BOOL FindPath(WORD startX, WORD startY, WORD endX, WORD endY);
+
+    /*!
+    *  \return cost of the path found by last FindPath (0 if not found)
+    */
+    DOUBLE GetLastCost() const { return m_Cost; }
+
+    /*!
+    *  \return cells of the path found by last FindPath, start and end included
+    */
+    const std::vector<Position>& GetLastPath() const { return m_Path; }
+
+    /*!
+    *  \return duration of last FindPath in milliseconds
+    */
+    DOUBLE GetLastDuration() const { return m_Duration; }
+
+    /*!
+    *  \return amount of nodes settled by last FindPath in both directions
+    */
+    size_t GetLastSettled() const { return m_Settled; }
+
+    /*!
+    *  \return preprocessing duration in milliseconds
+    */
+    DOUBLE GetBuildDuration() const { return m_BuildDuration; }
+
+    /*!
+    *  \return amount of added shortcuts
+    */
+    size_t GetShortcutsCount() const { return m_Shortcuts; }
+
+    /*!
+    *  \return size of query index in bytes
+    */
+    size_t GetIndexSize() const;
+
+  private:
+
+    /*!
+    *  Edge of the graph, middle is the node shortcut goes through
+    */
+    struct Edge
+    {
+      DWORD Node;
+      FLOAT Cost;
+      DWORD Middle;
+    };
+
+    /*!
+    *  Contracts node or only counts shortcuts it would need
+    *  \param node node to contract
+    *  \param simulate true to only count
+    *  \return amount of shortcuts
+    */
+    size_t Contract(DWORD node, BOOL simulate);
+
+    /*!
+    *  Local Dijkstra over nodes which are not contracted yet, except the one being contracted
+    *  \param source node to start from
+    *  \param skip node being contracted
+    *  \param limit no need to look further than this cost
+    *  \param targets amount of marked nodes, search stops when all are settled
+    *  \param settleLimit search gives up after this many settled nodes
+    */
+    VOID Witness(DWORD source, DWORD skip, FLOAT limit, size_t targets, size_t settleLimit);
+
+    /*!
+    *  Adds shortcut or makes existing edge cheaper
+    */
+    VOID AddShortcut(DWORD from, DWORD to, FLOAT cost, DWORD middle);
+
+    /*!
+    *  Appends nodes of edge (without from) to path, shortcuts are expanded
+    *  \param from first node of edge
+    *  \param to second node of edge
+    *  \param middle middle node of edge
+    *  \param nodes output
+    */
+    VOID Unpack(DWORD from, DWORD to, DWORD middle, std::vector<DWORD>& nodes) const;
+
+    /*!
+    *  \return edge among [begin, end) which goes to node
+    */
+    static const Edge* FindEdge(const Edge* begin, const Edge* end, DWORD node);
+
+    //
+    // map size
+    //
+    size_t m_Cols;
+    size_t m_Rows;
+
+    //
+    // node per cell (y * cols + x), position and terrain cost per node,
+    // nodes are numbered by rank, highest first
+    //
+    std::vector<DWORD> m_NodeByCell;
+    std::vector<Position> m_Positions;
+    std::vector<FLOAT> m_TerrainCosts;
+
+    //
+    // build graph, contracted node is removed from lists of its neighbours,
+    // so in the end every node keeps only edges to higher ranked ones
+    //
+    std::vector<std::vector<Edge>> m_Out;
+    std::vector<std::vector<Edge>> m_In;
+
+    //
+    // witness search scratch
+    //
+    std::vector<FLOAT> m_WitnessDist;
+    std::vector<DWORD> m_WitnessTouched;
+    std::vector<BYTE> m_WitnessTarget;
+
+    //
+    // query graph: edges to higher ranked nodes (forward search) and
+    // edges from higher ranked nodes (backward search), CSR by node
+    //
+    std::vector<DWORD> m_UpOffsets;
+    std::vector<Edge> m_Up;
+    std::vector<DWORD> m_DownOffsets;
+    std::vector<Edge> m_Down;
+
+    //
+    // query state, distances are reset only for touched nodes
+    //
+    std::vector<FLOAT> m_Dist[2];
+    std::vector<DWORD> m_Parent[2];
+    std::vector<DWORD> m_ParentMiddle[2];
+    std::vector<DWORD> m_Touched;
+    std::vector<std::pair<FLOAT, DWORD>> m_Heaps[2];
+    std::vector<DWORD> m_Scratch;
+    std::vector<DWORD> m_PathNodes;
+
+    //
+    // results
+    //
+    DOUBLE m_Cost;
+    DOUBLE m_Duration;
+    DOUBLE m_BuildDuration;
+    size_t m_Settled;
+    size_t m_Shortcuts;
+    std::vector<Position> m_Path;
+  };
+}
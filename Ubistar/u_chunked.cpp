@@ -0,0 +1,221 @@
+/*!
+ *  \brief     Chunked world impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_chunked.h"
+#include "u_world.h"
+
+#include <algorithm>
+#include <cstring>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// file signature and format version
+constexpr CHAR CHUNKED_MAGIC[4] = { 'U', 'B', 'C', 'M' };
+constexpr DWORD CHUNKED_VERSION = 1;
+
+// cell and its 8 neighbours may lie in 4 tiles, frontier keeps a few more warm
+constexpr size_t MIN_CACHE_TILES = 9;
+
+// distance to tile edge from which next tile is prefetched
+constexpr INT PREFETCH_MARGIN = 2;
+
+/************************************************
+ *  ChunkedWorld class impl
+ ***********************************************/
+
+ChunkedWorld::ChunkedWorld(std::basic_string<TCHAR> mapPath, size_t cacheTiles)
+  : m_File(mapPath, ios::binary), m_Valid(false), m_Cols(0), m_Rows(0),
+  m_TileSide(0), m_TilesPerRow(0), m_TilesPerCol(0),
+  m_Capacity(max(cacheTiles, MIN_CACHE_TILES)), m_Last(nullptr),
+  m_Faults(0), m_Prefetches(0)
+{
+  ChunkedHeader header = {};
+
+  if (!m_File.read(reinterpret_cast<CHAR*>(&header), sizeof(header)))
+  {
+    return;
+  }
+
+  if (memcmp(header.Magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC)) ||
+    header.Version != CHUNKED_VERSION ||
+    header.TileSide == 0 || header.TileSide > MAX_TILE_SIDE || header.Cols == 0 || header.Rows == 0)
+  {
+    return;
+  }
+
+  m_Cols = header.Cols;
+  m_Rows = header.Rows;
+  m_TileSide = header.TileSide;
+  m_TilesPerRow = (m_Cols + m_TileSide - 1) / m_TileSide;
+  m_TilesPerCol = (m_Rows + m_TileSide - 1) / m_TileSide;
+  m_ReadBuffer.resize(m_TileSide * m_TileSide);
+  m_Index.reserve(m_Capacity);
+  m_Valid = true;
+}
+
+BOOL ChunkedWorld::Convert(std::basic_string<TCHAR> textPath, size_t mapCols, size_t mapRows,
+  std::basic_string<TCHAR> binaryPath, size_t tileSide)
+{
+  basic_fstream<TCHAR> infile(textPath);
+  ofstream outfile(binaryPath, ios::binary | ios::trunc);
+
+  if (!infile || !outfile || tileSide == 0 || tileSide > MAX_TILE_SIDE) return false;
+
+  ChunkedHeader header = {};
+  memcpy(header.Magic, CHUNKED_MAGIC, sizeof(CHUNKED_MAGIC));
+  header.Version = CHUNKED_VERSION;
+  header.Cols = static_cast<DWORD>(mapCols);
+  header.Rows = static_cast<DWORD>(mapRows);
+  header.TileSide = static_cast<DWORD>(tileSide);
+  outfile.write(reinterpret_cast<const CHAR*>(&header), sizeof(header));
+
+  const auto tilesPerRow = (mapCols + tileSide - 1) / tileSide;
+  const auto bandCols = tilesPerRow * tileSide;
+
+  // one row of tiles, cells out of the map stay undefined
+  vector<CHAR> band(bandCols * tileSide);
+  TCHAR symbol;
+
+  for (size_t bandY = 0; bandY < mapRows; bandY += tileSide)
+  {
+    fill(band.begin(), band.end(), ' ');
+
+    for (size_t y = 0; y < tileSide && bandY + y < mapRows; y++)
+    {
+      for (size_t x = 0; x < mapCols && infile >> symbol; x++)
+      {
+        band[(y * bandCols) + x] = static_cast<CHAR>(symbol);
+      }
+    }
+
+    for (size_t tile = 0; tile < tilesPerRow; tile++)
+    {
+      for (size_t y = 0; y < tileSide; y++)
+      {
+        outfile.write(&band[(y * bandCols) + (tile * tileSide)], tileSide);
+      }
+    }
+  }
+
+  return outfile.good();
+}
+
+FLOAT ChunkedWorld::GetTerrainCost(INT x, INT y)
+{
+  if (x < 0 || y < 0 || static_cast<size_t>(x) >= m_Cols || static_cast<size_t>(y) >= m_Rows)
+  {
+    return 0.0f;
+  }
+
+  auto key = ((y / m_TileSide) * m_TilesPerRow) + (x / m_TileSide);
+  auto tile = Touch(key, false);
+
+  return tile->Costs[((y % m_TileSide) * m_TileSide) + (x % m_TileSide)];
+}
+
+VOID ChunkedWorld::PrefetchAround(INT x, INT y)
+{
+  auto side = static_cast<INT>(m_TileSide);
+  auto tileX = x / side;
+  auto tileY = y / side;
+  auto localX = x % side;
+  auto localY = y % side;
+
+  // which edges of the tile are close
+  auto dx = localX < PREFETCH_MARGIN ? -1 : (localX >= side - PREFETCH_MARGIN ? 1 : 0);
+  auto dy = localY < PREFETCH_MARGIN ? -1 : (localY >= side - PREFETCH_MARGIN ? 1 : 0);
+
+  if (!dx && !dy) return;
+
+  const INT candidates[3][2] = { { dx, 0 }, { 0, dy }, { dx, dy } };
+
+  for (const auto& candidate : candidates)
+  {
+    if (!candidate[0] && !candidate[1]) continue;
+
+    auto nextX = tileX + candidate[0];
+    auto nextY = tileY + candidate[1];
+
+    if (nextX < 0 || nextY < 0 ||
+      static_cast<size_t>(nextX) >= m_TilesPerRow || static_cast<size_t>(nextY) >= m_TilesPerCol)
+    {
+      continue;
+    }
+
+    Touch((static_cast<DWORD64>(nextY) * m_TilesPerRow) + nextX, true);
+  }
+}
+
+ChunkedWorld::Tile* ChunkedWorld::Touch(DWORD64 key, BOOL prefetch)
+{
+  if (m_Last && m_Last->Key == key) return m_Last;
+
+  auto found = m_Index.find(key);
+
+  if (found != m_Index.end())
+  {
+    m_Tiles.splice(m_Tiles.begin(), m_Tiles, found->second);
+    m_Last = &m_Tiles.front();
+    return m_Last;
+  }
+
+  // read blocks search same as fault, it is not worth a tile search may need
+  if (prefetch && m_Tiles.size() >= m_Capacity) return nullptr;
+
+  // least recently used tile gives its memory to the new one
+  if (m_Tiles.size() < m_Capacity)
+  {
+    m_Tiles.emplace_front();
+    m_Tiles.front().Costs.resize(m_TileSide * m_TileSide);
+  }
+  else
+  {
+    m_Index.erase(m_Tiles.back().Key);
+    m_Tiles.splice(m_Tiles.begin(), m_Tiles, prev(m_Tiles.end()));
+  }
+
+  auto& tile = m_Tiles.front();
+  tile.Key = key;
+
+  m_File.clear();
+  m_File.seekg(sizeof(ChunkedHeader) + (key * m_ReadBuffer.size()));
+
+  if (!m_File.read(m_ReadBuffer.data(), m_ReadBuffer.size()))
+  {
+    // broken file, tile is treated as water
+    fill(m_ReadBuffer.begin(), m_ReadBuffer.end(), '*');
+  }
+
+  // same symbols as in text map, so costs are taken from Coordinate
+  Coordinate decoder;
+  for (size_t i = 0; i < m_ReadBuffer.size(); i++)
+  {
+    decoder.SetTerrain(static_cast<TCHAR>(m_ReadBuffer[i]));
+    tile.Costs[i] = decoder.GetTerrainCost();
+  }
+
+  m_Index[key] = m_Tiles.begin();
+  m_Last = &tile;
+
+  // every read blocks search thread
+  m_Faults++;
+  if (prefetch) m_Prefetches++;
+
+  return m_Last;
+}
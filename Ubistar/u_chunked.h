@@ -0,0 +1,192 @@
+#pragma once
+
+/*!
+ *  \brief     Chunked world
+ *  \details   World which is split into square tiles kept in binary file,
+ *             only bounded amount of tiles is loaded at the same time
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include <Windows.h>
+#include <tchar.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <fstream>
+#include <unordered_map>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Header of binary map file, tiles go right after it
+  *  row after row, each tile is TileSide * TileSide symbols
+  */
+  struct ChunkedHeader
+  {
+    CHAR Magic[4];
+    DWORD Version;
+    DWORD Cols;
+    DWORD Rows;
+    DWORD TileSide;
+  };
+
+  /*!
+  *  Terrain costs of the map, tiles are loaded on demand into LRU cache
+  */
+  class ChunkedWorld
+  {
+  public:
+
+    /*!
+    *  largest side of tile, bigger one in header means file is broken
+    */
+    static constexpr size_t MAX_TILE_SIDE = 4096;
+
+    /*!
+    *  ctor with params, only header is read here
+    *  \param mapPath path to binary map file
+    *  \param cacheTiles max amount of tiles kept in memory
+    */
+    ChunkedWorld(std::basic_string<TCHAR> mapPath, size_t cacheTiles);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~ChunkedWorld() = default;
+
+    /*!
+    *  Converts text map (same format World reads) into binary map file.
+    *  Text is read band by band, so only one row of tiles is kept in memory
+    *  \param textPath path to text map
+    *  \param mapCols amount of cols in text map
+    *  \param mapRows amount of rows in text map
+    *  \param binaryPath path to resulting binary map
+    *  \param tileSide side of one tile
+    *  \return true if file is written
+    */
+    static BOOL Convert(std::basic_string<TCHAR> textPath, size_t mapCols, size_t mapRows,
+      std::basic_string<TCHAR> binaryPath, size_t tileSide);
+
+    /*!
+    *  \return true if file was opened and header is valid
+    */
+    BOOL IsValid() const { return m_Valid; }
+
+    /*!
+    *  map size
+    */
+    size_t GetCols() const { return m_Cols; }
+    size_t GetRows() const { return m_Rows; }
+
+    /*!
+    *  Terrain cost of the tile, tile is loaded if it is not in cache
+    *  \param x col, may be out of the map
+    *  \param y row, may be out of the map
+    *  \return cost, 0 if cell can not be entered or is out of the map
+    */
+    FLOAT GetTerrainCost(INT x, INT y);
+
+    /*!
+    *  Loads tiles next to the cell if cell is close to the tile edge,
+    *  so search finds them in cache when frontier crosses the edge.
+    *  Tile is read on calling thread, so it is loaded only into free
+    *  cache slot and never evicts tiles search may still need
+    *  \param x col
+    *  \param y row
+    */
+    VOID PrefetchAround(INT x, INT y);
+
+    /*!
+    *  \return amount of tiles read from file, search waits for each of them,
+    *          so prefetched ones are counted too
+    */
+    size_t GetFaults() const { return m_Faults; }
+
+    /*!
+    *  \return amount of tiles loaded by PrefetchAround, part of faults
+    */
+    size_t GetPrefetches() const { return m_Prefetches; }
+
+  private:
+
+    /*!
+    *  One loaded tile
+    */
+    struct Tile
+    {
+      DWORD64 Key;
+      std::vector<FLOAT> Costs;
+    };
+
+    /*!
+    *  Finds tile in cache and moves it to the front, loads it otherwise
+    *  \param key index of tile
+    *  \param prefetch true if called by PrefetchAround
+    *  \return ref to tile, nullptr if prefetched tile would evict another
+    */
+    Tile* Touch(DWORD64 key, BOOL prefetch);
+
+    //
+    // binary map file
+    //
+    std::ifstream m_File;
+
+    //
+    // header was read fine
+    //
+    BOOL m_Valid;
+
+    //
+    // map size
+    //
+    size_t m_Cols;
+    size_t m_Rows;
+
+    //
+    // tiles params
+    //
+    size_t m_TileSide;
+    size_t m_TilesPerRow;
+    size_t m_TilesPerCol;
+
+    //
+    // max amount of loaded tiles
+    //
+    size_t m_Capacity;
+
+    //
+    // loaded tiles, most recently used first
+    //
+    std::list<Tile> m_Tiles;
+
+    //
+    // index of loaded tiles
+    //
+    std::unordered_map<DWORD64, std::list<Tile>::iterator> m_Index;
+
+    //
+    // last touched tile, most requests go to the same tile
+    //
+    Tile* m_Last;
+
+    //
+    // buffer to read one tile from the file
+    //
+    std::vector<CHAR> m_ReadBuffer;
+
+    //
+    // statistics
+    //
+    size_t m_Faults;
+    size_t m_Prefetches;
+  };
+}
@@ -0,0 +1,288 @@
+/*!
+ *  \brief     Compressed path database impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_cpd.h"
+
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include <cmath>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// cell is blocked
+constexpr DWORD NO_COMPONENT = MAXDWORD;
+
+// distance of cells search did not reach yet
+constexpr FLOAT UNREACHED = numeric_limits<FLOAT>::max();
+
+// first move is not known yet
+constexpr BYTE NO_MOVE = MAXBYTE;
+
+// run keeps move in low bits, the rest is key
+constexpr DWORD MOVE_BITS = 3;
+constexpr DWORD MOVE_MASK = (1 << MOVE_BITS) - 1;
+
+// just to shorten, min heap by distance
+using HeapItem = pair<FLOAT, DWORD>;
+
+/************************************************
+ *  PathDatabase class impl
+ ***********************************************/
+
+PathDatabase::PathDatabase(const World& world, size_t threads)
+  : m_Cols(world.GetCols()), m_Rows(world.GetRows()), m_BuildDuration(0), m_Threads(threads),
+  m_Cost(0), m_Duration(0)
+{
+  auto start = high_resolution_clock::now();
+
+  if (world.GetPaddedSize() > (MAXDWORD >> MOVE_BITS))
+  {
+    throw runtime_error("Map is too large for path database");
+  }
+
+  auto cells = m_Cols * m_Rows;
+  const auto* costs = world.GetPaddedCosts();
+
+  m_Costs.resize(cells);
+  m_Keys.resize(cells);
+  m_Components.resize(cells, NO_COMPONENT);
+
+  for (size_t y = 0; y < m_Rows; y++)
+  {
+    for (size_t x = 0; x < m_Cols; x++)
+    {
+      auto index = world.GetPaddedIndex(static_cast<WORD>(x), static_cast<WORD>(y));
+      m_Costs[y * m_Cols + x] = costs[index];
+      m_Keys[y * m_Cols + x] = static_cast<DWORD>(index);
+    }
+  }
+
+  // every step can be made back, so cells reach each other only inside a component
+  DWORD components = 0;
+  vector<DWORD> stack;
+
+  for (DWORD cell = 0; cell < cells; cell++)
+  {
+    if (m_Costs[cell] <= 0.0f || m_Components[cell] != NO_COMPONENT) continue;
+
+    m_Components[cell] = components;
+    stack.push_back(cell);
+
+    while (!stack.empty())
+    {
+      auto current = stack.back();
+      stack.pop_back();
+
+      INT x = static_cast<INT>(current % m_Cols);
+      INT y = static_cast<INT>(current / m_Cols);
+
+      for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+      {
+        INT nx = x + DIRECTION_DX[i];
+        INT ny = y + DIRECTION_DY[i];
+
+        if (nx < 0 || ny < 0 || nx >= static_cast<INT>(m_Cols) || ny >= static_cast<INT>(m_Rows)) continue;
+
+        auto neighbour = ny * m_Cols + nx;
+        if (m_Costs[neighbour] <= 0.0f || m_Components[neighbour] != NO_COMPONENT) continue;
+
+        m_Components[neighbour] = components;
+        stack.push_back(static_cast<DWORD>(neighbour));
+      }
+    }
+
+    components++;
+  }
+
+  // layout order keeps close targets together, so their moves form long runs
+  m_Order.resize(cells);
+  for (DWORD cell = 0; cell < cells; cell++) m_Order[cell] = cell;
+  sort(m_Order.begin(), m_Order.end(), [this](DWORD a, DWORD b) { return m_Keys[a] < m_Keys[b]; });
+
+  if (!m_Threads) m_Threads = max(thread::hardware_concurrency(), 1u);
+
+  // sources are taken one by one, so slow and fast sources spread evenly
+  vector<vector<DWORD>> tables(cells);
+  atomic<DWORD> next(0);
+
+  auto worker = [&]()
+  {
+    vector<FLOAT> dist(cells);
+    vector<BYTE> moves(cells);
+    vector<HeapItem> heap;
+
+    for (DWORD source = next++; source < cells; source = next++)
+    {
+      if (m_Components[source] == NO_COMPONENT) continue;
+
+      BuildSource(source, dist, moves, heap, tables[source]);
+    }
+  };
+
+  vector<thread> pool;
+  for (size_t i = 1; i < m_Threads; i++) pool.emplace_back(worker);
+
+  worker();
+
+  for (auto& thread : pool) thread.join();
+
+  m_Offsets.resize(cells + 1);
+
+  size_t total = 0;
+  for (const auto& table : tables) total += table.size();
+  m_Runs.reserve(total);
+
+  for (DWORD cell = 0; cell < cells; cell++)
+  {
+    m_Offsets[cell] = static_cast<DWORD>(m_Runs.size());
+    m_Runs.insert(m_Runs.end(), tables[cell].begin(), tables[cell].end());
+    vector<DWORD>().swap(tables[cell]);
+  }
+
+  m_Offsets[cells] = static_cast<DWORD>(m_Runs.size());
+  vector<DWORD>().swap(m_Order);
+
+  auto end = high_resolution_clock::now();
+  m_BuildDuration = duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+VOID PathDatabase::BuildSource(DWORD source, std::vector<FLOAT>& dist, std::vector<BYTE>& moves,
+  std::vector<std::pair<FLOAT, DWORD>>& heap, std::vector<DWORD>& runs) const
+{
+  const auto diagonal = sqrtf(2.0f);
+
+  fill(dist.begin(), dist.end(), UNREACHED);
+  fill(moves.begin(), moves.end(), NO_MOVE);
+  heap.clear();
+
+  dist[source] = 0;
+  heap.push_back({ 0.0f, source });
+
+  while (!heap.empty())
+  {
+    pop_heap(heap.begin(), heap.end(), greater<HeapItem>());
+    auto [current, cell] = heap.back();
+    heap.pop_back();
+
+    if (current > dist[cell]) continue;
+
+    INT x = static_cast<INT>(cell % m_Cols);
+    INT y = static_cast<INT>(cell / m_Cols);
+
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      INT nx = x + DIRECTION_DX[i];
+      INT ny = y + DIRECTION_DY[i];
+
+      if (nx < 0 || ny < 0 || nx >= static_cast<INT>(m_Cols) || ny >= static_cast<INT>(m_Rows)) continue;
+
+      auto neighbour = static_cast<DWORD>(ny * m_Cols + nx);
+      auto cost = m_Costs[neighbour];
+
+      if (cost <= 0.0f) continue;
+
+      // same as search does: cost of cell stepped on times length of step
+      auto next = current + cost * (i < 4 ? 1.0f : diagonal);
+      if (next >= dist[neighbour]) continue;
+
+      dist[neighbour] = next;
+      moves[neighbour] = cell == source ? i : moves[cell];
+
+      heap.push_back({ next, neighbour });
+      push_heap(heap.begin(), heap.end(), greater<HeapItem>());
+    }
+  }
+
+  // targets out of component and the source itself are never asked, they join any run
+  for (auto target : m_Order)
+  {
+    auto move = moves[target];
+    if (move == NO_MOVE) continue;
+
+    if (runs.empty() || (runs.back() & MOVE_MASK) != move)
+    {
+      runs.push_back((m_Keys[target] << MOVE_BITS) | move);
+    }
+  }
+
+  runs.shrink_to_fit();
+}
+
+BYTE PathDatabase::GetMove(DWORD source, DWORD target) const
+{
+  auto begin = m_Runs.begin() + m_Offsets[source];
+  auto end = m_Runs.begin() + m_Offsets[source + 1];
+
+  // last run which starts not after the target
+  auto key = (m_Keys[target] << MOVE_BITS) | MOVE_MASK;
+  auto run = upper_bound(begin, end, key);
+
+  return static_cast<BYTE>(*(run - 1) & MOVE_MASK);
+}
+
+BOOL PathDatabase::FindPath(WORD startX, WORD startY, WORD endX, WORD endY)
+{
+  auto start = high_resolution_clock::now();
+
+  m_Cost = 0;
+  m_Path.clear();
+
+  auto source = static_cast<DWORD>(startY * m_Cols + startX);
+  auto target = static_cast<DWORD>(endY * m_Cols + endX);
+
+  BOOL found = m_Components[source] != NO_COMPONENT && m_Components[source] == m_Components[target];
+
+  if (found)
+  {
+    const auto diagonal = sqrt(2.0);
+    auto x = startX;
+    auto y = startY;
+
+    m_Path.push_back({ x, y });
+
+    for (auto cell = source; cell != target; cell = static_cast<DWORD>(y * m_Cols + x))
+    {
+      auto move = GetMove(cell, target);
+
+      x = static_cast<WORD>(x + DIRECTION_DX[move]);
+      y = static_cast<WORD>(y + DIRECTION_DY[move]);
+
+      m_Path.push_back({ x, y });
+      m_Cost += m_Costs[y * m_Cols + x] * (move < 4 ? 1.0 : diagonal);
+    }
+  }
+
+  // query takes less than microsecond on short paths
+  auto end = high_resolution_clock::now();
+  m_Duration = duration_cast<nanoseconds>(end - start).count() / 1000000.0;
+
+  return found;
+}
+
+size_t PathDatabase::GetSize() const
+{
+  return (m_Runs.size() + m_Offsets.size() + m_Keys.size() + m_Components.size()) * sizeof(DWORD)
+    + m_Costs.size() * sizeof(FLOAT);
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+/*!
+ *  \brief     Compressed path database
+ *  \details   First move tables of every source cell, built from World
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_world.h"
+
+#include <Windows.h>
+#include <vector>
+#include <utility>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  For every passable source cell keeps the first move of a shortest path
+  *  to every target. Targets are ordered as cells of world layout and equal
+  *  moves of neighbour targets are merged into runs. Blocked targets and
+  *  targets which source can not reach may join any run, so they cost nothing.
+  *  Query only follows first moves, one lookup per step
+  */
+  class PathDatabase
+  {
+  public:
+
+    /*!
+    *  ctor, tables of all sources are built here
+    *  \param world world to build database for, it is not kept
+    *  \param threads amount of build threads, 0 to use all cores
+    */
+    PathDatabase(const World& world, size_t threads = 0);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~PathDatabase() = default;
+
+    /*!
+    *  Point to point query
+    *  \param startX x coordinate (col) of start pos
+    *  \param startY y coordinate (row) of start pos
+    *  \param endX x coordinate (col) of end pos
+    *  \param endY y coordinate (row) of end pos
+    *  \return true if path is found
+    */
+    BOOL FindPath(WORD startX, WORD startY, WORD endX, WORD endY);
+
+    /*!
+    *  \return cost of the path found by last FindPath (0 if not found)
+    */
+    DOUBLE GetLastCost() const { return m_Cost; }
+
+    /*!
+    *  \return cells of the path found by last FindPath, start and end included
+    */
+    const std::vector<Position>& GetLastPath() const { return m_Path; }
+
+    /*!
+    *  \return duration of last FindPath in milliseconds
+    */
+    DOUBLE GetLastDuration() const { return m_Duration; }
+
+    /*!
+    *  \return build duration in milliseconds
+    */
+    DOUBLE GetBuildDuration() const { return m_BuildDuration; }
+
+    /*!
+    *  \return amount of threads tables were built with
+    */
+    size_t GetThreadsCount() const { return m_Threads; }
+
+    /*!
+    *  \return amount of runs of all sources
+    */
+    size_t GetRunsCount() const { return m_Runs.size(); }
+
+    /*!
+    *  \return size of database in bytes
+    */
+    size_t GetSize() const;
+
+  private:
+
+    /*!
+    *  Dijkstra from source, then first moves are packed into runs
+    *  \param source cell to build table for
+    *  \param dist scratch of the calling thread
+    *  \param moves scratch of the calling thread
+    *  \param heap scratch of the calling thread
+    *  \param runs output
+    */
+    VOID BuildSource(DWORD source, std::vector<FLOAT>& dist, std::vector<BYTE>& moves,
+      std::vector<std::pair<FLOAT, DWORD>>& heap, std::vector<DWORD>& runs) const;
+
+    /*!
+    *  \return first move from source to target
+    */
+    BYTE GetMove(DWORD source, DWORD target) const;
+
+    //
+    // map size
+    //
+    size_t m_Cols;
+    size_t m_Rows;
+
+    //
+    // per cell (y * cols + x): terrain cost, connected component
+    // and key which orders targets in tables
+    //
+    std::vector<FLOAT> m_Costs;
+    std::vector<DWORD> m_Components;
+    std::vector<DWORD> m_Keys;
+
+    //
+    // cells sorted by key, dropped when build is done
+    //
+    std::vector<DWORD> m_Order;
+
+    //
+    // runs of all sources one after another, each is key of its first
+    // target shifted left by 3 with move in low bits
+    //
+    std::vector<DWORD> m_Offsets;
+    std::vector<DWORD> m_Runs;
+
+    //
+    // build info
+    //
+    DOUBLE m_BuildDuration;
+    size_t m_Threads;
+
+    //
+    // results
+    //
+    DOUBLE m_Cost;
+    DOUBLE m_Duration;
+    std::vector<Position> m_Path;
+  };
+}
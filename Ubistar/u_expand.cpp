@@ -0,0 +1,193 @@
+/*!
+ *  \brief     Neighbour expansion kernel impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_expand.h"
+
+#include <intrin.h>
+#include <cmath>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define UBISTAR_SSE
+#endif
+
+using Kernel = BYTE(*)(const ExpansionInput&, FLOAT*, FLOAT*);
+
+/************************************************
+ *  Kernels impl
+ ***********************************************/
+
+/*!
+*  Plain loop, used when cpu has no simd we know about
+*/
+BYTE ExpandScalar(const ExpansionInput& input, FLOAT* outG, FLOAT* outH)
+{
+  BYTE mask = 0;
+
+  for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+  {
+    auto neighbour = input.Neighbours[i];
+    auto cost = input.Costs[neighbour];
+    auto step = i < 4 ? input.Weight : input.DiagWeight;
+    auto dx = input.X + DIRECTION_DX[i] - input.EndX;
+    auto dy = input.Y + DIRECTION_DY[i] - input.EndY;
+
+    outG[i] = input.CurrentG + (cost * step);
+    outH[i] = input.Weight * sqrtf((dx * dx) + (dy * dy));
+
+    if (cost > 0.0f && outG[i] < input.G[neighbour])
+    {
+      mask |= 1 << i;
+    }
+  }
+
+  return mask;
+}
+
+#ifdef UBISTAR_SSE
+
+/*!
+*  Two halves of 4 lanes, straight directions first then diagonal ones
+*/
+BYTE ExpandSse(const ExpansionInput& input, FLOAT* outG, FLOAT* outH)
+{
+  const auto* n = input.Neighbours;
+  const auto currentG = _mm_set1_ps(input.CurrentG);
+  const auto dx = _mm_set1_ps(input.X - input.EndX);
+  const auto dy = _mm_set1_ps(input.Y - input.EndY);
+  const auto weight = _mm_set1_ps(input.Weight);
+  const auto zero = _mm_setzero_ps();
+
+  BYTE mask = 0;
+
+  for (BYTE half = 0; half < 2; half++)
+  {
+    auto base = half * 4;
+
+    // no gather in sse, collect lanes by hand
+    auto cost = _mm_setr_ps(input.Costs[n[base]], input.Costs[n[base + 1]],
+      input.Costs[n[base + 2]], input.Costs[n[base + 3]]);
+    auto stored = _mm_setr_ps(input.G[n[base]], input.G[n[base + 1]],
+      input.G[n[base + 2]], input.G[n[base + 3]]);
+
+    auto step = _mm_set1_ps(half ? input.DiagWeight : input.Weight);
+    auto g = _mm_add_ps(currentG, _mm_mul_ps(cost, step));
+
+    auto x = _mm_add_ps(dx, _mm_setr_ps(
+      static_cast<FLOAT>(DIRECTION_DX[base]), static_cast<FLOAT>(DIRECTION_DX[base + 1]),
+      static_cast<FLOAT>(DIRECTION_DX[base + 2]), static_cast<FLOAT>(DIRECTION_DX[base + 3])));
+    auto y = _mm_add_ps(dy, _mm_setr_ps(
+      static_cast<FLOAT>(DIRECTION_DY[base]), static_cast<FLOAT>(DIRECTION_DY[base + 1]),
+      static_cast<FLOAT>(DIRECTION_DY[base + 2]), static_cast<FLOAT>(DIRECTION_DY[base + 3])));
+    auto h = _mm_mul_ps(weight, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))));
+
+    auto improved = _mm_and_ps(_mm_cmpgt_ps(cost, zero), _mm_cmplt_ps(g, stored));
+
+    _mm_storeu_ps(outG + base, g);
+    _mm_storeu_ps(outH + base, h);
+    mask |= static_cast<BYTE>(_mm_movemask_ps(improved) << base);
+  }
+
+  return mask;
+}
+
+/*!
+*  All 8 lanes at once with hardware gather
+*/
+BYTE ExpandAvx2(const ExpansionInput& input, FLOAT* outG, FLOAT* outH)
+{
+  auto indexes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input.Neighbours));
+  auto cost = _mm256_i32gather_ps(input.Costs, indexes, sizeof(FLOAT));
+  auto stored = _mm256_i32gather_ps(input.G, indexes, sizeof(FLOAT));
+
+  auto step = _mm256_setr_ps(
+    input.Weight, input.Weight, input.Weight, input.Weight,
+    input.DiagWeight, input.DiagWeight, input.DiagWeight, input.DiagWeight);
+  auto g = _mm256_add_ps(_mm256_set1_ps(input.CurrentG), _mm256_mul_ps(cost, step));
+
+  auto x = _mm256_add_ps(_mm256_set1_ps(input.X - input.EndX),
+    _mm256_setr_ps(0.0f, 1.0f, 0.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f));
+  auto y = _mm256_add_ps(_mm256_set1_ps(input.Y - input.EndY),
+    _mm256_setr_ps(-1.0f, 0.0f, 1.0f, 0.0f, -1.0f, 1.0f, 1.0f, -1.0f));
+  auto h = _mm256_mul_ps(_mm256_set1_ps(input.Weight),
+    _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y, y))));
+
+  auto improved = _mm256_and_ps(
+    _mm256_cmp_ps(cost, _mm256_setzero_ps(), _CMP_GT_OQ),
+    _mm256_cmp_ps(g, stored, _CMP_LT_OQ));
+
+  _mm256_storeu_ps(outG, g);
+  _mm256_storeu_ps(outH, h);
+
+  return static_cast<BYTE>(_mm256_movemask_ps(improved));
+}
+
+/*!
+*  Checks cpu and os both support avx2 (ymm state is saved on context switch)
+*/
+BOOL IsAvx2Supported()
+{
+  INT info[4] = {};
+
+  __cpuidex(info, 0, 0);
+  if (info[0] < 7) return false;
+
+  __cpuidex(info, 1, 0);
+  auto osxsave = (info[2] & (1 << 27)) != 0;
+  auto avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx) return false;
+  if ((_xgetbv(0) & 0x6) != 0x6) return false;
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+}
+
+#endif
+
+/*!
+*  Picks best kernel once on startup
+*/
+Kernel PickKernel()
+{
+#ifdef UBISTAR_SSE
+  return IsAvx2Supported() ? ExpandAvx2 : ExpandSse;
+#else
+  return ExpandScalar;
+#endif
+}
+
+const Kernel SELECTED_KERNEL = PickKernel();
+
+/************************************************
+ *  Functions impl
+ ***********************************************/
+
+BYTE ubistar::ExpandNeighbours(const ExpansionInput& input, FLOAT outG[NEIGHBOURS_COUNT], FLOAT outH[NEIGHBOURS_COUNT])
+{
+  return SELECTED_KERNEL(input, outG, outH);
+}
+
+const CHAR* ubistar::GetExpansionKernelName()
+{
+#ifdef UBISTAR_SSE
+  if (SELECTED_KERNEL == ExpandAvx2) return "avx2";
+  if (SELECTED_KERNEL == ExpandSse) return "sse";
+#endif
+  return "scalar";
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+/*!
+ *  \brief     Neighbour expansion kernel
+ *  \details   Vectorised (AVX2 / SSE) and scalar variants of the step
+ *             that turns one expanded cell into 8 candidate neighbours
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include <Windows.h>
+
+  /************************************************
+   *  decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Amount of neighbours each cell has (size of DIRECTIONS)
+  */
+  constexpr BYTE NEIGHBOURS_COUNT = 8;
+
+  /*!
+  *  Column and row offsets matching DIRECTIONS order
+  */
+  constexpr INT DIRECTION_DX[NEIGHBOURS_COUNT] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+  constexpr INT DIRECTION_DY[NEIGHBOURS_COUNT] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+
+  /*!
+  *  Everything kernel needs to know about expanded cell
+  */
+  struct ExpansionInput
+  {
+    //
+    // terrain cost per cell, 0 means cell can not be entered
+    //
+    const FLOAT* Costs;
+
+    //
+    // best known g per cell, closed cells hold lowest float value
+    // so no candidate can improve them
+    //
+    const FLOAT* G;
+
+    //
+    // indexes of 8 neighbours in Costs and G (DIRECTIONS order)
+    //
+    const DWORD* Neighbours;
+
+    //
+    // g value of expanded cell
+    //
+    FLOAT CurrentG;
+
+    //
+    // position of expanded cell and of the goal
+    //
+    FLOAT X;
+    FLOAT Y;
+    FLOAT EndX;
+    FLOAT EndY;
+
+    //
+    // multipliers for straight and diagonal movement
+    //
+    FLOAT Weight;
+    FLOAT DiagWeight;
+  };
+
+  /*!
+  *  Calculates g and h of all 8 neighbours in one go and compares new g
+  *  against stored ones
+  *  \param input expanded cell and grids to read from
+  *  \param outG candidate g values in DIRECTIONS order
+  *  \param outH heuristic values in DIRECTIONS order
+  *  \return mask where bit i is set if neighbour i is passable and improved
+  */
+  BYTE ExpandNeighbours(const ExpansionInput& input, FLOAT outG[NEIGHBOURS_COUNT], FLOAT outH[NEIGHBOURS_COUNT]);
+
+  /*!
+  *  \return name of kernel picked for this cpu ("avx2", "sse" or "scalar")
+  */
+  const CHAR* GetExpansionKernelName();
+}
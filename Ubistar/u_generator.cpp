@@ -0,0 +1,562 @@
+/*!
+ *  \brief     Map generator impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_generator.h"
+#include "u_expand.h"
+
+#include <fstream>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// area of water cells
+constexpr DWORD NO_AREA = MAXDWORD;
+
+// finest noise octave, cells per lattice step
+constexpr size_t MIN_NOISE_SCALE = 4;
+
+// smallest side of room
+constexpr size_t MIN_ROOM_SIDE = 4;
+
+// rooms in a row which add less than quarter of their area before land is grown instead
+constexpr size_t MAX_IDLE_ROOMS = 64;
+
+// long haul query takes the farthest of this amount of ends
+constexpr size_t LONG_HAUL_CANDIDATES = 16;
+
+/************************************************
+ *  Functions impl
+ ***********************************************/
+
+/*!
+*  Value below which given share of values is
+*  \param values values, copy is reordered
+*  \param share from 0 to 1
+*  \return threshold, values below it make the share
+*/
+FLOAT GetQuantile(vector<FLOAT> values, DOUBLE share)
+{
+  if (values.empty() || share <= 0.0) return numeric_limits<FLOAT>::lowest();
+  if (share >= 1.0) return numeric_limits<FLOAT>::max();
+
+  auto nth = values.begin() + static_cast<size_t>(share * values.size());
+  nth_element(values.begin(), nth, values.end());
+
+  return *nth;
+}
+
+/************************************************
+ *  MapGenerator class impl
+ ***********************************************/
+
+MapGenerator::MapGenerator(size_t cols, size_t rows, const GeneratorSettings& settings)
+  : m_Cols(cols), m_Rows(rows), m_Settings(settings), m_Cells(cols * rows, '.')
+{
+  if (cols == 0 || rows == 0)
+  {
+    throw runtime_error("Map size is out of range");
+  }
+
+  if (settings.Water < 0 || settings.Water >= 1 || settings.Swamp < 0 || settings.Mountain < 0 ||
+    settings.Swamp + settings.Mountain > 1)
+  {
+    throw runtime_error("Terrain shares are out of range");
+  }
+
+  if (settings.Water < GetMinWaterShare(settings.Structure, cols, rows))
+  {
+    throw runtime_error("Water share is below what structure can reach");
+  }
+
+  mt19937 generator(settings.Seed);
+
+  switch (settings.Structure)
+  {
+  case MAP_STRUCTURE::NOISE:
+    GenerateNoise(generator);
+    break;
+  case MAP_STRUCTURE::MAZE:
+    GenerateMaze(generator);
+    break;
+  case MAP_STRUCTURE::ROOMS:
+    GenerateRooms(generator);
+    break;
+  }
+
+  ApplyTerrain(generator);
+  FindAreas();
+}
+
+std::vector<FLOAT> MapGenerator::MakeNoise(std::mt19937& generator) const
+{
+  uniform_real_distribution<FLOAT> distribution(0.0f, 1.0f);
+  vector<FLOAT> noise(m_Cols * m_Rows, 0.0f);
+  vector<FLOAT> lattice;
+
+  // coarse octave shapes continents, finer ones add details with half weight
+  auto scale = max(max(m_Cols, m_Rows) / 4, MIN_NOISE_SCALE);
+  FLOAT amplitude = 1.0f;
+
+  do
+  {
+    auto latticeCols = m_Cols / scale + 2;
+    auto latticeRows = m_Rows / scale + 2;
+
+    lattice.resize(latticeCols * latticeRows);
+    for (auto& value : lattice) value = distribution(generator);
+
+    for (size_t y = 0; y < m_Rows; y++)
+    {
+      auto ly = y / scale;
+      auto ty = static_cast<FLOAT>(y % scale) / scale;
+      ty = ty * ty * (3 - 2 * ty);
+
+      for (size_t x = 0; x < m_Cols; x++)
+      {
+        auto lx = x / scale;
+        auto tx = static_cast<FLOAT>(x % scale) / scale;
+        tx = tx * tx * (3 - 2 * tx);
+
+        auto top = lattice[ly * latticeCols + lx] * (1 - tx) + lattice[ly * latticeCols + lx + 1] * tx;
+        auto bottom = lattice[(ly + 1) * latticeCols + lx] * (1 - tx) + lattice[(ly + 1) * latticeCols + lx + 1] * tx;
+
+        noise[y * m_Cols + x] += amplitude * (top * (1 - ty) + bottom * ty);
+      }
+    }
+
+    amplitude /= 2;
+    scale /= 2;
+  } while (scale >= MIN_NOISE_SCALE);
+
+  return noise;
+}
+
+VOID MapGenerator::GenerateNoise(std::mt19937& generator)
+{
+  auto noise = MakeNoise(generator);
+  auto threshold = GetQuantile(noise, m_Settings.Water);
+
+  for (size_t cell = 0; cell < m_Cells.size(); cell++)
+  {
+    m_Cells[cell] = noise[cell] < threshold ? '*' : '.';
+  }
+}
+
+VOID MapGenerator::GenerateMaze(std::mt19937& generator)
+{
+  fill(m_Cells.begin(), m_Cells.end(), '*');
+
+  // maze nodes are on even positions, odd ones between them are walls
+  auto nodeCols = (m_Cols + 1) / 2;
+  auto nodeRows = (m_Rows + 1) / 2;
+
+  vector<BYTE> visited(nodeCols * nodeRows, false);
+  vector<size_t> stack = { 0 };
+  visited[0] = true;
+  m_Cells[0] = '.';
+
+  // depth first carving gives long winding corridors
+  while (!stack.empty())
+  {
+    auto node = stack.back();
+    auto nx = node % nodeCols;
+    auto ny = node / nodeCols;
+
+    size_t next[4];
+    BYTE count = 0;
+
+    for (BYTE i = 0; i < 4; i++)
+    {
+      auto x = static_cast<INT>(nx) + DIRECTION_DX[i];
+      auto y = static_cast<INT>(ny) + DIRECTION_DY[i];
+
+      if (x < 0 || y < 0 || x >= static_cast<INT>(nodeCols) || y >= static_cast<INT>(nodeRows)) continue;
+      if (visited[y * nodeCols + x]) continue;
+
+      next[count++] = y * nodeCols + x;
+    }
+
+    if (!count)
+    {
+      stack.pop_back();
+      continue;
+    }
+
+    auto chosen = next[uniform_int_distribution<INT>(0, count - 1)(generator)];
+    auto cx = chosen % nodeCols;
+    auto cy = chosen / nodeCols;
+
+    visited[chosen] = true;
+    m_Cells[(2 * cy) * m_Cols + 2 * cx] = '.';
+    m_Cells[(ny + cy) * m_Cols + nx + cx] = '.';
+    stack.push_back(chosen);
+  }
+
+  // walls between two corridors are opened in random order until water share is reached
+  vector<size_t> walls;
+  for (size_t y = 0; y < m_Rows; y++)
+  {
+    for (size_t x = (y + 1) % 2; x < m_Cols; x += 2)
+    {
+      auto cell = y * m_Cols + x;
+      if (IsPassable(cell)) continue;
+
+      BOOL horizontal = x > 0 && x + 1 < m_Cols && IsPassable(cell - 1) && IsPassable(cell + 1);
+      BOOL vertical = y > 0 && y + 1 < m_Rows && IsPassable(cell - m_Cols) && IsPassable(cell + m_Cols);
+
+      if (horizontal || vertical) walls.push_back(cell);
+    }
+  }
+
+  shuffle(walls.begin(), walls.end(), generator);
+
+  auto water = static_cast<size_t>(count(m_Cells.begin(), m_Cells.end(), '*'));
+  auto target = static_cast<size_t>(m_Settings.Water * m_Cells.size());
+
+  for (auto wall = walls.begin(); wall != walls.end() && water > target; wall++, water--)
+  {
+    m_Cells[*wall] = '.';
+  }
+}
+
+VOID MapGenerator::GenerateRooms(std::mt19937& generator)
+{
+  fill(m_Cells.begin(), m_Cells.end(), '*');
+
+  auto minSide = min({ MIN_ROOM_SIDE, m_Cols, m_Rows });
+  auto maxSide = max(minSide, min(m_Cols, m_Rows) / 8);
+
+  uniform_int_distribution<size_t> sideDistribution(minSide, maxSide);
+
+  auto target = static_cast<size_t>((1.0 - m_Settings.Water) * m_Cells.size());
+  size_t land = 0;
+
+  auto carve = [&](size_t x, size_t y)
+  {
+    auto& cell = m_Cells[y * m_Cols + x];
+    if (cell == '*') land++;
+    cell = '.';
+  };
+
+  // rooms overlap more as map fills, once they mostly land on carved cells
+  // the rest of land is grown from its edges
+  size_t previousX = 0;
+  size_t previousY = 0;
+  BOOL first = true;
+
+  for (size_t idle = 0; land < target && idle < MAX_IDLE_ROOMS;)
+  {
+    auto before = land;
+    auto width = min(sideDistribution(generator), m_Cols);
+    auto height = min(sideDistribution(generator), m_Rows);
+    auto left = uniform_int_distribution<size_t>(0, m_Cols - width)(generator);
+    auto top = uniform_int_distribution<size_t>(0, m_Rows - height)(generator);
+
+    for (auto y = top; y < top + height; y++)
+    {
+      for (auto x = left; x < left + width; x++) carve(x, y);
+    }
+
+    auto centerX = left + width / 2;
+    auto centerY = top + height / 2;
+
+    // corridor goes along row of previous room, then along col of the new one
+    if (!first)
+    {
+      for (auto x = min(previousX, centerX); x <= max(previousX, centerX); x++) carve(x, previousY);
+      for (auto y = min(previousY, centerY); y <= max(previousY, centerY); y++) carve(centerX, y);
+    }
+
+    previousX = centerX;
+    previousY = centerY;
+    first = false;
+
+    idle = (land - before) * 4 < width * height ? idle + 1 : 0;
+  }
+
+  vector<size_t> frontier;
+  vector<BYTE> queued(m_Cells.size(), false);
+
+  auto pushNeighbours = [&](size_t cell)
+  {
+    auto x = static_cast<INT>(cell % m_Cols);
+    auto y = static_cast<INT>(cell / m_Cols);
+
+    for (BYTE i = 0; i < 4; i++)
+    {
+      auto nx = x + DIRECTION_DX[i];
+      auto ny = y + DIRECTION_DY[i];
+
+      if (nx < 0 || ny < 0 || nx >= static_cast<INT>(m_Cols) || ny >= static_cast<INT>(m_Rows)) continue;
+
+      auto neighbour = ny * m_Cols + nx;
+      if (IsPassable(neighbour) || queued[neighbour]) continue;
+
+      queued[neighbour] = true;
+      frontier.push_back(neighbour);
+    }
+  };
+
+  if (land < target)
+  {
+    for (size_t cell = 0; cell < m_Cells.size(); cell++)
+    {
+      if (IsPassable(cell)) pushNeighbours(cell);
+    }
+  }
+
+  // water cell next to land is taken in random order, so edges stay ragged
+  while (land < target && !frontier.empty())
+  {
+    auto index = uniform_int_distribution<size_t>(0, frontier.size() - 1)(generator);
+    auto cell = frontier[index];
+    frontier[index] = frontier.back();
+    frontier.pop_back();
+
+    carve(cell % m_Cols, cell / m_Cols);
+    pushNeighbours(cell);
+  }
+}
+
+VOID MapGenerator::ApplyTerrain(std::mt19937& generator)
+{
+  auto noise = MakeNoise(generator);
+
+  vector<FLOAT> land;
+  for (size_t cell = 0; cell < m_Cells.size(); cell++)
+  {
+    if (IsPassable(cell)) land.push_back(noise[cell]);
+  }
+
+  // low noise is swamp, high is mountain, so each forms patches
+  auto swampThreshold = GetQuantile(land, m_Settings.Swamp);
+  auto mountainThreshold = GetQuantile(land, 1.0 - m_Settings.Mountain);
+
+  for (size_t cell = 0; cell < m_Cells.size(); cell++)
+  {
+    if (!IsPassable(cell)) continue;
+
+    if (noise[cell] < swampThreshold) m_Cells[cell] = '-';
+    else if (noise[cell] >= mountainThreshold) m_Cells[cell] = '^';
+  }
+}
+
+VOID MapGenerator::FindAreas()
+{
+  m_Areas.assign(m_Cells.size(), NO_AREA);
+  m_AreaSizes.clear();
+
+  vector<size_t> stack;
+
+  for (size_t cell = 0; cell < m_Cells.size(); cell++)
+  {
+    if (!IsPassable(cell) || m_Areas[cell] != NO_AREA) continue;
+
+    auto area = static_cast<DWORD>(m_AreaSizes.size());
+    m_AreaSizes.push_back(0);
+    m_Areas[cell] = area;
+    stack.push_back(cell);
+
+    while (!stack.empty())
+    {
+      auto current = stack.back();
+      stack.pop_back();
+      m_AreaSizes[area]++;
+
+      INT x = static_cast<INT>(current % m_Cols);
+      INT y = static_cast<INT>(current / m_Cols);
+
+      for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+      {
+        INT nx = x + DIRECTION_DX[i];
+        INT ny = y + DIRECTION_DY[i];
+
+        if (nx < 0 || ny < 0 || nx >= static_cast<INT>(m_Cols) || ny >= static_cast<INT>(m_Rows)) continue;
+
+        auto neighbour = ny * m_Cols + nx;
+        if (!IsPassable(neighbour) || m_Areas[neighbour] != NO_AREA) continue;
+
+        m_Areas[neighbour] = area;
+        stack.push_back(neighbour);
+      }
+    }
+  }
+}
+
+BOOL MapGenerator::Write(std::basic_string<TCHAR> path) const
+{
+  ofstream outfile(path, ios::trunc);
+  if (!outfile) return false;
+
+  string line;
+
+  for (size_t y = 0; y < m_Rows; y++)
+  {
+    line.assign(m_Cells, y * m_Cols, m_Cols);
+    line += '\n';
+    outfile.write(line.data(), line.size());
+  }
+
+  return static_cast<BOOL>(outfile.good());
+}
+
+VOID MapGenerator::GenerateQueries(WORKLOAD workload, size_t count, UINT seed, std::vector<GeneratedQuery>& queries) const
+{
+  queries.clear();
+
+  if (m_AreaSizes.empty()) return;
+
+  auto largest = static_cast<DWORD>(max_element(m_AreaSizes.begin(), m_AreaSizes.end()) - m_AreaSizes.begin());
+
+  // passable cells, the ones of largest area first
+  vector<DWORD> inside;
+  vector<DWORD> outside;
+
+  for (size_t cell = 0; cell < m_Cells.size(); cell++)
+  {
+    if (m_Areas[cell] == NO_AREA) continue;
+    (m_Areas[cell] == largest ? inside : outside).push_back(static_cast<DWORD>(cell));
+  }
+
+  if (workload == WORKLOAD::UNREACHABLE && outside.empty()) return;
+
+  mt19937 generator(seed);
+
+  auto pick = [&generator](const vector<DWORD>& cells)
+  {
+    return cells[uniform_int_distribution<size_t>(0, cells.size() - 1)(generator)];
+  };
+
+  auto position = [this](DWORD cell) -> Position
+  {
+    return { static_cast<WORD>(cell % m_Cols), static_cast<WORD>(cell / m_Cols) };
+  };
+
+  auto octile = [this](DWORD a, DWORD b)
+  {
+    auto dx = abs(static_cast<INT>(a % m_Cols) - static_cast<INT>(b % m_Cols));
+    auto dy = abs(static_cast<INT>(a / m_Cols) - static_cast<INT>(b / m_Cols));
+    return max(dx, dy) + (sqrt(2.0) - 1) * min(dx, dy);
+  };
+
+  vector<DWORD> passable(inside);
+  passable.insert(passable.end(), outside.begin(), outside.end());
+
+  queries.reserve(count);
+
+  for (size_t i = 0; i < count; i++)
+  {
+    DWORD start = 0;
+    DWORD end = 0;
+
+    switch (workload)
+    {
+    case WORKLOAD::RANDOM:
+      start = pick(passable);
+      end = pick(passable);
+      break;
+    case WORKLOAD::LONG_HAUL:
+    {
+      start = pick(inside);
+      end = pick(inside);
+
+      for (size_t candidate = 1; candidate < LONG_HAUL_CANDIDATES; candidate++)
+      {
+        auto other = pick(inside);
+        if (octile(start, other) > octile(start, end)) end = other;
+      }
+    }
+    break;
+    case WORKLOAD::UNREACHABLE:
+      start = pick(inside);
+      end = pick(outside);
+      if (generator() % 2) swap(start, end);
+      break;
+    }
+
+    queries.push_back({ position(start), position(end) });
+  }
+}
+
+DOUBLE MapGenerator::GetWaterShare() const
+{
+  return static_cast<DOUBLE>(count(m_Cells.begin(), m_Cells.end(), '*')) / m_Cells.size();
+}
+
+DOUBLE MapGenerator::GetMinWaterShare(MAP_STRUCTURE structure, size_t cols, size_t rows)
+{
+  if (structure != MAP_STRUCTURE::MAZE || !cols || !rows) return 0;
+
+  // pillars between four maze nodes are never opened, nor walls on the last
+  // col or row of even sized map, as there is no node behind them
+  auto water = (cols / 2) * (rows / 2);
+  if (cols % 2 == 0) water += (rows + 1) / 2;
+  if (rows % 2 == 0) water += (cols + 1) / 2;
+
+  return static_cast<DOUBLE>(water) / (cols * rows);
+}
+
+const CHAR* MapGenerator::GetStructureName(MAP_STRUCTURE structure)
+{
+  switch (structure)
+  {
+  case MAP_STRUCTURE::NOISE:
+    return "noise";
+  case MAP_STRUCTURE::MAZE:
+    return "maze";
+  case MAP_STRUCTURE::ROOMS:
+    return "rooms";
+  }
+
+  return "unknown";
+}
+
+const CHAR* MapGenerator::GetWorkloadName(WORKLOAD workload)
+{
+  switch (workload)
+  {
+  case WORKLOAD::RANDOM:
+    return "random";
+  case WORKLOAD::LONG_HAUL:
+    return "long";
+  case WORKLOAD::UNREACHABLE:
+    return "unreachable";
+  }
+
+  return "unknown";
+}
+
+BOOL MapGenerator::ParseStructure(const std::basic_string<TCHAR>& name, MAP_STRUCTURE& structure)
+{
+  for (auto candidate : { MAP_STRUCTURE::NOISE, MAP_STRUCTURE::MAZE, MAP_STRUCTURE::ROOMS })
+  {
+    string candidateName = GetStructureName(candidate);
+
+    if (basic_string<TCHAR>(candidateName.begin(), candidateName.end()) == name)
+    {
+      structure = candidate;
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,240 @@
+#pragma once
+
+/*!
+ *  \brief     Map generator
+ *  \details   Seeded synthetic maps in World file format and query
+ *             workloads matching them
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_world.h"
+
+#include <Windows.h>
+#include <tchar.h>
+#include <string>
+#include <vector>
+#include <random>
+#include <utility>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  How water is laid out
+  */
+  enum class MAP_STRUCTURE
+  {
+    //
+    // smooth noise, water fills its lowest part (lakes and coasts)
+    //
+    NOISE,
+
+    //
+    // maze of one cell corridors, walls are opened until water share is reached
+    //
+    MAZE,
+
+    //
+    // rectangular rooms joined by corridors, everything else is water
+    //
+    ROOMS
+  };
+
+  /*!
+  *  Kinds of query workloads
+  */
+  enum class WORKLOAD
+  {
+    //
+    // both ends are random passable cells
+    //
+    RANDOM,
+
+    //
+    // ends are far from each other inside the largest area
+    //
+    LONG_HAUL,
+
+    //
+    // ends are in areas which are not connected
+    //
+    UNREACHABLE
+  };
+
+  /*!
+  *  Generator params, shares are from 0 to 1
+  */
+  struct GeneratorSettings
+  {
+    MAP_STRUCTURE Structure;
+    UINT Seed;
+
+    //
+    // share of water in the map
+    //
+    DOUBLE Water;
+
+    //
+    // shares of swamps and mountains in passable cells
+    //
+    DOUBLE Swamp;
+    DOUBLE Mountain;
+  };
+
+  /*!
+  *  Query of workload, start and end
+  */
+  using GeneratedQuery = std::pair<Position, Position>;
+
+  /*!
+  *  Generates map once in ctor, then it may be written in World format
+  *  and asked for query workloads. Same settings give same map
+  */
+  class MapGenerator
+  {
+  public:
+
+    /*!
+    *  ctor, map is generated here
+    *  \param cols amount of cols
+    *  \param rows amount of rows
+    *  \param settings params of map
+    *
+    *  \details throws runtime_error if settings are out of range
+    *           or water share is below GetMinWaterShare
+    */
+    MapGenerator(size_t cols, size_t rows, const GeneratorSettings& settings);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~MapGenerator() = default;
+
+    /*!
+    *  Writes map, row per line, as World reads it
+    *  \param path path to file
+    *  \return true if file is written
+    */
+    BOOL Write(std::basic_string<TCHAR> path) const;
+
+    /*!
+    *  Generates workload, same seed gives same queries
+    *  \param workload kind of queries
+    *  \param count amount of queries
+    *  \param seed seed of queries
+    *  \param queries output, cleared first, stays empty if map has no
+    *                 such pairs (one area only for unreachable ones)
+    */
+    VOID GenerateQueries(WORKLOAD workload, size_t count, UINT seed, std::vector<GeneratedQuery>& queries) const;
+
+    /*!
+    *  \return map size
+    */
+    size_t GetCols() const { return m_Cols; }
+    size_t GetRows() const { return m_Rows; }
+
+    /*!
+    *  \return symbols of cells, y * cols + x
+    */
+    const std::string& GetCells() const { return m_Cells; }
+
+    /*!
+    *  \return amount of connected passable areas
+    */
+    size_t GetAreasCount() const { return m_AreaSizes.size(); }
+
+    /*!
+    *  \return share of water in generated map
+    */
+    DOUBLE GetWaterShare() const;
+
+    /*!
+    *  \param structure structure
+    *  \param cols amount of cols
+    *  \param rows amount of rows
+    *  \return lowest water share structure reaches on map of this size,
+    *          maze keeps pillars between corridors
+    */
+    static DOUBLE GetMinWaterShare(MAP_STRUCTURE structure, size_t cols, size_t rows);
+
+    /*!
+    *  \param structure structure
+    *  \return text name of structure
+    */
+    static const CHAR* GetStructureName(MAP_STRUCTURE structure);
+
+    /*!
+    *  \param workload workload
+    *  \return text name of workload
+    */
+    static const CHAR* GetWorkloadName(WORKLOAD workload);
+
+    /*!
+    *  \param name text name of structure
+    *  \param structure output
+    *  \return false if name is unknown
+    */
+    static BOOL ParseStructure(const std::basic_string<TCHAR>& name, MAP_STRUCTURE& structure);
+
+  private:
+
+    /*!
+    *  Smooth value noise, octaves of random lattices with bilinear interpolation
+    *  \param generator source of lattice values
+    *  \return value per cell
+    */
+    std::vector<FLOAT> MakeNoise(std::mt19937& generator) const;
+
+    /*!
+    *  Water layouts of structures
+    */
+    VOID GenerateNoise(std::mt19937& generator);
+    VOID GenerateMaze(std::mt19937& generator);
+    VOID GenerateRooms(std::mt19937& generator);
+
+    /*!
+    *  Splits passable cells into plains, swamps and mountains by noise
+    */
+    VOID ApplyTerrain(std::mt19937& generator);
+
+    /*!
+    *  Finds areas, cells are connected in 8 directions same as search goes
+    */
+    VOID FindAreas();
+
+    /*!
+    *  \return true if cell is passable
+    */
+    BOOL IsPassable(size_t cell) const { return m_Cells[cell] != '*'; }
+
+    //
+    // map size
+    //
+    size_t m_Cols;
+    size_t m_Rows;
+
+    //
+    // params
+    //
+    GeneratorSettings m_Settings;
+
+    //
+    // symbols of cells
+    //
+    std::string m_Cells;
+
+    //
+    // area per cell (MAXDWORD for water) and amount of cells per area
+    //
+    std::vector<DWORD> m_Areas;
+    std::vector<size_t> m_AreaSizes;
+  };
+}
@@ -0,0 +1,151 @@
+/*!
+ *  \brief     Cell indexing schemes impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_layout.h"
+
+#include <cstdint>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// side of tile in TILED layout (power of two)
+constexpr size_t TILE_BITS = 4;
+constexpr size_t TILE_SIDE = 1 << TILE_BITS;
+constexpr size_t TILE_MASK = TILE_SIDE - 1;
+
+// bits of x and y in Morton index
+constexpr size_t X_BITS = 0x5555555555555555ull & SIZE_MAX;
+constexpr size_t Y_BITS = X_BITS << 1;
+
+/************************************************
+ *  CellLayout class impl
+ ***********************************************/
+
+CellLayout::CellLayout(CELL_LAYOUT layout, size_t cols, size_t rows)
+  : m_Layout(layout), m_Cols(cols), m_Rows(rows), m_Size(0), m_TilesPerRow(0), m_Offsets()
+{
+  switch (m_Layout)
+  {
+  case CELL_LAYOUT::ROW_MAJOR:
+  {
+    m_Size = cols * rows;
+
+    // negative offsets wrap around, adding them to index still works
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      m_Offsets[i] = static_cast<DWORD>((DIRECTION_DY[i] * static_cast<INT>(cols)) + DIRECTION_DX[i]);
+    }
+  }
+  break;
+  case CELL_LAYOUT::MORTON:
+  {
+    size_t side = 1;
+    while (side < cols || side < rows) side <<= 1;
+    m_Size = side * side;
+  }
+  break;
+  case CELL_LAYOUT::TILED:
+  {
+    m_TilesPerRow = (cols + TILE_MASK) >> TILE_BITS;
+    m_Size = m_TilesPerRow * ((rows + TILE_MASK) >> TILE_BITS) * TILE_SIDE * TILE_SIDE;
+  }
+  break;
+  }
+}
+
+size_t CellLayout::Spread(size_t value)
+{
+  value &= 0xFFFF;
+  value = (value | (value << 8)) & 0x00FF00FF;
+  value = (value | (value << 4)) & 0x0F0F0F0F;
+  value = (value | (value << 2)) & 0x33333333;
+  value = (value | (value << 1)) & 0x55555555;
+  return value;
+}
+
+size_t CellLayout::GetIndex(size_t x, size_t y) const
+{
+  switch (m_Layout)
+  {
+  case CELL_LAYOUT::MORTON:
+    return Spread(x) | (Spread(y) << 1);
+  case CELL_LAYOUT::TILED:
+  {
+    auto tile = ((y >> TILE_BITS) * m_TilesPerRow) + (x >> TILE_BITS);
+    return (tile << (2 * TILE_BITS)) | Spread(x & TILE_MASK) | (Spread(y & TILE_MASK) << 1);
+  }
+  default:
+    return (m_Cols * y) + x;
+  }
+}
+
+VOID CellLayout::GetNeighbours(size_t index, size_t x, size_t y, DWORD neighbours[NEIGHBOURS_COUNT]) const
+{
+  switch (m_Layout)
+  {
+  case CELL_LAYOUT::ROW_MAJOR:
+  {
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      neighbours[i] = static_cast<DWORD>(index) + m_Offsets[i];
+    }
+  }
+  break;
+  case CELL_LAYOUT::MORTON:
+  {
+    // dilated arithmetic, filling foreign bits with ones carries the
+    // increment over them, clearing them lets decrement borrow over them
+    auto xPart = index & X_BITS;
+    auto yPart = index & Y_BITS;
+    auto xInc = ((index | Y_BITS) + 1) & X_BITS;
+    auto xDec = (xPart - 1) & X_BITS;
+    auto yInc = ((index | X_BITS) + 2) & Y_BITS;
+    auto yDec = (yPart - 2) & Y_BITS;
+
+    neighbours[0] = static_cast<DWORD>(xPart | yDec);
+    neighbours[1] = static_cast<DWORD>(xInc | yPart);
+    neighbours[2] = static_cast<DWORD>(xPart | yInc);
+    neighbours[3] = static_cast<DWORD>(xDec | yPart);
+    neighbours[4] = static_cast<DWORD>(xInc | yDec);
+    neighbours[5] = static_cast<DWORD>(xInc | yInc);
+    neighbours[6] = static_cast<DWORD>(xDec | yInc);
+    neighbours[7] = static_cast<DWORD>(xDec | yDec);
+  }
+  break;
+  case CELL_LAYOUT::TILED:
+  {
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      neighbours[i] = static_cast<DWORD>(GetIndex(x + DIRECTION_DX[i], y + DIRECTION_DY[i]));
+    }
+  }
+  break;
+  }
+}
+
+const CHAR* CellLayout::GetName() const
+{
+  switch (m_Layout)
+  {
+  case CELL_LAYOUT::MORTON:
+    return "morton";
+  case CELL_LAYOUT::TILED:
+    return "tiled";
+  default:
+    return "row-major";
+  }
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+/*!
+ *  \brief     Cell indexing schemes
+ *  \details   Maps cell position to index in World containers,
+ *             row-major, Z-order (Morton) and tiled orders are supported
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_expand.h"
+
+#include <Windows.h>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Supported orders of cells in memory
+  */
+  enum class CELL_LAYOUT
+  {
+    //
+    // row after row, index = y * cols + x
+    //
+    ROW_MAJOR,
+
+    //
+    // bits of x and y interleaved, grid is rounded up to power of two square
+    //
+    MORTON,
+
+    //
+    // row-major grid of 16 x 16 tiles, Morton order inside each tile
+    //
+    TILED
+  };
+
+  /*!
+  *  Index calculator for one grid
+  */
+  class CellLayout
+  {
+  public:
+
+    /*!
+    *  ctor with grid params
+    *  \param layout order of cells
+    *  \param cols amount of cols in grid
+    *  \param rows amount of rows in grid
+    */
+    CellLayout(CELL_LAYOUT layout, size_t cols, size_t rows);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~CellLayout() = default;
+
+    /*!
+    *  \return order of cells
+    */
+    CELL_LAYOUT GetType() const { return m_Layout; }
+
+    /*!
+    *  \return amount of elements container must have, may be larger
+    *          than cols * rows if layout needs alignment
+    */
+    size_t GetSize() const { return m_Size; }
+
+    /*!
+    *  \param x col
+    *  \param y row
+    *  \return index of the cell
+    */
+    size_t GetIndex(size_t x, size_t y) const;
+
+    /*!
+    *  Calculates indexes of all 8 neighbours, caller guarantees
+    *  that cell is not on the grid edge
+    *  \param index index of the cell
+    *  \param x col of the cell
+    *  \param y row of the cell
+    *  \param neighbours indexes in DIRECTIONS order
+    */
+    VOID GetNeighbours(size_t index, size_t x, size_t y, DWORD neighbours[NEIGHBOURS_COUNT]) const;
+
+    /*!
+    *  \return text name of layout
+    */
+    const CHAR* GetName() const;
+
+  private:
+
+    /*!
+    *  \param value number to spread
+    *  \return value with zero bit inserted after every bit
+    */
+    static size_t Spread(size_t value);
+
+    //
+    // order of cells
+    //
+    CELL_LAYOUT m_Layout;
+
+    //
+    // grid size
+    //
+    size_t m_Cols;
+    size_t m_Rows;
+
+    //
+    // amount of elements in container
+    //
+    size_t m_Size;
+
+    //
+    // amount of tiles in one row of tiles
+    //
+    size_t m_TilesPerRow;
+
+    //
+    // row-major only, index distance to neighbours (DIRECTIONS order)
+    //
+    DWORD m_Offsets[NEIGHBOURS_COUNT];
+  };
+}
@@ -10,6 +10,9 @@
  ***********************************************/
 
 #include "u_astar.h"
+#include "u_bench.h"
+#include "u_server.h"
+#include "u_generator.h"
 
 #include <Windows.h>
 #include <tchar.h>
@@ -17,6 +20,8 @@
 #include <string>
 #include <memory>
 #include <iostream>
+#include <fstream>
+#include <algorithm>
 #include <shlwapi.h>
 
 /************************************************
@@ -53,6 +58,48 @@ constexpr BYTE MAP_COLS = 126;
 */
 InputTuple ProcessInput(const int& argc, TCHAR* argv[]);
 
+/*!
+*  Converts text map into binary chunked map
+*  \param argc equals to 6 or 7
+*  \param argv contains the following pattern:
+*              astar.exe convert MapFileName Cols Rows ChunkedFileName [TileSide]
+*              where MapFileName - path to text map
+*                    Cols Rows - size of the map
+*                    ChunkedFileName - path to resulting binary map
+*                    TileSide - side of one tile (64 by default, 4096 at most)
+*  \return 0 in success, or error code
+*/
+int RunConvert(const int& argc, TCHAR* argv[]);
+
+/*!
+*  Searches path in chunked map, tiles are loaded from file on demand
+*  \param argc equals to 7 or 8
+*  \param argv contains the following pattern:
+*              astar.exe stream ChunkedFileName StartX StartY EndX EndY [CacheTiles]
+*              where ChunkedFileName - path to binary map made by convert
+*                    StartX StartY - start position
+*                    EndX EndY - end position
+*                    CacheTiles - max amount of tiles in memory (64 by default)
+*  \return 0 in success, or error code
+*/
+int RunStream(const int& argc, TCHAR* argv[]);
+
+/*!
+*  Generates map and query workloads for it
+*  \param argc from 5 to 10
+*  \param argv contains the following pattern:
+*              astar.exe generate MapFileName Cols Rows [structure] [seed] [water swamp mountain]
+*              where MapFileName - path to resulting map, queries are written
+*                                  next to it with .queries suffix
+*                    Cols Rows - size of the map
+*                    structure - noise, maze or rooms (noise by default)
+*                    seed - seed for map and queries (0 by default)
+*                    water - share of water in map (0.25 by default)
+*                    swamp mountain - shares of them in passable cells (0.15 and 0.1 by default)
+*  \return 0 in success, or error code
+*/
+int RunGenerate(const int& argc, TCHAR* argv[]);
+
 /************************************************
  *  Executable entry point
  ***********************************************/
@@ -70,6 +117,50 @@ InputTuple ProcessInput(const int& argc, TCHAR* argv[]);
 */
 int _tmain(int argc, TCHAR* argv[])
 {
+  // values which are present as first arg in other modes
+  LPCTSTR BENCH_MODE = _T("bench");
+  LPCTSTR CONVERT_MODE = _T("convert");
+  LPCTSTR STREAM_MODE = _T("stream");
+  LPCTSTR SERVE_MODE = _T("serve");
+  LPCTSTR GENERATE_MODE = _T("generate");
+  LPCTSTR SCALE_MODE = _T("scale");
+  LPCTSTR AGENTS_MODE = _T("agents");
+
+  if (argc > 1 && !_tcscmp(argv[1], BENCH_MODE))
+  {
+    return RunBenchmark(argc, argv);
+  }
+
+  if (argc > 1 && !_tcscmp(argv[1], CONVERT_MODE))
+  {
+    return RunConvert(argc, argv);
+  }
+
+  if (argc > 1 && !_tcscmp(argv[1], STREAM_MODE))
+  {
+    return RunStream(argc, argv);
+  }
+
+  if (argc > 1 && !_tcscmp(argv[1], SERVE_MODE))
+  {
+    return RunServer(argc, argv);
+  }
+
+  if (argc > 1 && !_tcscmp(argv[1], GENERATE_MODE))
+  {
+    return RunGenerate(argc, argv);
+  }
+
+  if (argc > 1 && !_tcscmp(argv[1], SCALE_MODE))
+  {
+    return RunScalingBenchmark(argc, argv);
+  }
+
+  if (argc > 1 && !_tcscmp(argv[1], AGENTS_MODE))
+  {
+    return RunAgentsBenchmark(argc, argv);
+  }
+
   // unpacking input params
   basic_string<TCHAR> mapPath;
   BYTE startX;
@@ -91,11 +182,12 @@ int _tmain(int argc, TCHAR* argv[])
 
   // TODO need to make abstact class IPathider in order to communicate via interfaces, not realisation
   // TODO need to make AStar class - template to operate with map size (now it is BYTE) in case if it will be larger
-  unique_ptr<AStar> pathFinder = make_unique<AStar>(mapPath, MAP_COLS, MAP_ROWS, showmap);
-  auto result = pathFinder->FindPath(startX, startY, endX, endY);
+  // searcher lives on stack, its arenas are the only memory query needs
+  AStar pathFinder(mapPath, MAP_COLS, MAP_ROWS, showmap);
+  pathFinder.FindPath(startX, startY, endX, endY);
 
   // TODO better to overload << operator, refactor later
-  pathFinder->Print();
+  pathFinder.Print();
 }
 
 /************************************************
@@ -160,4 +252,194 @@ InputTuple ProcessInput(const int& argc, TCHAR* argv[])
   }
 
   return { mapPath, startX, startY, endX, endY, showmap };
-}
\ No newline at end of file
+}
+
+int RunConvert(const int& argc, TCHAR* argv[])
+{
+  constexpr BYTE MIN_INPUT_AMOUNT = 6;
+  constexpr BYTE MAX_INPUT_AMOUNT = 7;
+
+  try
+  {
+    if (argc < MIN_INPUT_AMOUNT || argc > MAX_INPUT_AMOUNT)
+    {
+      throw runtime_error("Amount of input args are wrong");
+    }
+
+    if (!PathFileExists(argv[2]))
+    {
+      throw runtime_error("Path to map file is wrong");
+    }
+
+    auto cols = stoul(argv[3]);
+    auto rows = stoul(argv[4]);
+    auto tileSide = MAX_INPUT_AMOUNT == argc ? stoul(argv[6]) : 64;
+
+    if (cols == 0 || rows == 0 || cols > MAXWORD || rows > MAXWORD)
+    {
+      throw runtime_error("Map size is out of range");
+    }
+
+    if (tileSide == 0 || tileSide > ChunkedWorld::MAX_TILE_SIDE)
+    {
+      throw runtime_error("Tile side is out of range");
+    }
+
+    if (!ChunkedWorld::Convert(argv[2], cols, rows, argv[5], tileSide))
+    {
+      throw runtime_error("Chunked map can not be written");
+    }
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return ERROR_INVALID_DATA;
+  }
+
+  return 0;
+}
+
+int RunStream(const int& argc, TCHAR* argv[])
+{
+  constexpr BYTE MIN_INPUT_AMOUNT = 7;
+  constexpr BYTE MAX_INPUT_AMOUNT = 8;
+
+  unique_ptr<AStar> pathFinder;
+  WORD position[4];
+
+  try
+  {
+    if (argc < MIN_INPUT_AMOUNT || argc > MAX_INPUT_AMOUNT)
+    {
+      throw runtime_error("Amount of input args are wrong");
+    }
+
+    // chunked map keeps no rendered copy of the map
+    if (MAX_INPUT_AMOUNT == argc && !_tcscmp(argv[7], _T("showmap")))
+    {
+      throw runtime_error("showmap is not supported on chunked maps");
+    }
+
+    auto cacheTiles = MAX_INPUT_AMOUNT == argc ? stoul(argv[7]) : 64;
+    auto world = make_unique<ChunkedWorld>(argv[2], cacheTiles);
+
+    if (!world->IsValid())
+    {
+      throw runtime_error("Chunked map file is wrong");
+    }
+
+    for (BYTE i = 0; i < 4; i++)
+    {
+      auto limit = (i % 2) ? world->GetRows() : world->GetCols();
+      auto value = stoul(argv[3 + i]);
+
+      if (value >= limit)
+      {
+        throw runtime_error("Input coordinate is out of range");
+      }
+
+      position[i] = static_cast<WORD>(value);
+    }
+
+    pathFinder = make_unique<AStar>(move(world));
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return ERROR_INVALID_DATA;
+  }
+
+  pathFinder->FindPath(position[0], position[1], position[2], position[3]);
+  pathFinder->Print();
+
+  return 0;
+}
+
+int RunGenerate(const int& argc, TCHAR* argv[])
+{
+  constexpr BYTE MIN_INPUT_AMOUNT = 5;
+  constexpr BYTE MAX_INPUT_AMOUNT = 10;
+
+  // amount of queries per workload
+  constexpr size_t QUERIES_AMOUNT = 100;
+
+  const WORKLOAD WORKLOADS[] = { WORKLOAD::RANDOM, WORKLOAD::LONG_HAUL, WORKLOAD::UNREACHABLE };
+
+  try
+  {
+    // terrain shares go together
+    if (argc < MIN_INPUT_AMOUNT || argc > MAX_INPUT_AMOUNT || argc == MAX_INPUT_AMOUNT - 1 || argc == MAX_INPUT_AMOUNT - 2)
+    {
+      throw runtime_error("Amount of input args are wrong");
+    }
+
+    auto cols = stoul(argv[3]);
+    auto rows = stoul(argv[4]);
+
+    // one tile border is added around the map, it still has to fit in WORD
+    if (cols == 0 || rows == 0 || cols > MAXWORD - 2 || rows > MAXWORD - 2)
+    {
+      throw runtime_error("Map size is out of range");
+    }
+
+    GeneratorSettings settings = { MAP_STRUCTURE::NOISE, 0, 0.25, 0.15, 0.1 };
+
+    if (argc > 5 && !MapGenerator::ParseStructure(argv[5], settings.Structure))
+    {
+      throw runtime_error("Map structure is unknown");
+    }
+
+    if (argc > 6) settings.Seed = stoul(argv[6]);
+
+    if (argc == MAX_INPUT_AMOUNT)
+    {
+      settings.Water = stod(argv[7]);
+      settings.Swamp = stod(argv[8]);
+      settings.Mountain = stod(argv[9]);
+    }
+    else
+    {
+      // default water may be below what maze can reach
+      settings.Water = max(settings.Water, MapGenerator::GetMinWaterShare(settings.Structure, cols, rows));
+    }
+
+    MapGenerator generator(cols, rows, settings);
+
+    basic_string<TCHAR> mapPath = argv[2];
+    if (!generator.Write(mapPath))
+    {
+      throw runtime_error("Generated map can not be written");
+    }
+
+    // one query per line: workload StartX StartY EndX EndY
+    ofstream outfile(mapPath + _T(".queries"), ios::trunc);
+    vector<GeneratedQuery> queries;
+
+    for (BYTE i = 0; i < sizeof(WORKLOADS) / sizeof(WORKLOADS[0]); i++)
+    {
+      generator.GenerateQueries(WORKLOADS[i], QUERIES_AMOUNT, settings.Seed + i, queries);
+
+      for (const auto& [start, end] : queries)
+      {
+        outfile << MapGenerator::GetWorkloadName(WORKLOADS[i]) << ' '
+          << start.X << ' ' << start.Y << ' ' << end.X << ' ' << end.Y << '\n';
+      }
+    }
+
+    if (!outfile)
+    {
+      throw runtime_error("Queries can not be written");
+    }
+
+    cout << "Map size: " << cols << " x " << rows << endl;
+    cout << "Water share: " << generator.GetWaterShare() << endl;
+    cout << "Areas: " << generator.GetAreasCount() << endl;
+  }
+  catch (exception& e)
+  {
+    cerr << e.what() << endl;
+    return ERROR_INVALID_DATA;
+  }
+
+  return 0;
+}
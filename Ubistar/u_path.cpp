@@ -0,0 +1,115 @@
+/*!
+ *  \brief     Compact path impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_path.h"
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+
+/************************************************
+ *  Path::Iterator class impl
+ ***********************************************/
+
+Path::Iterator& Path::Iterator::operator++()
+{
+  // there is no move after end, iterator just becomes end one
+  if (m_Index < m_Path->GetMovesCount())
+  {
+    auto move = m_Path->GetMove(m_Index);
+    m_Position.X = static_cast<WORD>(m_Position.X + DIRECTION_DX[move]);
+    m_Position.Y = static_cast<WORD>(m_Position.Y + DIRECTION_DY[move]);
+  }
+
+  m_Index++;
+
+  return *this;
+}
+
+/************************************************
+ *  Path class impl
+ ***********************************************/
+
+Path::Path()
+  : m_Start(), m_End(), m_Length(0), m_Found(false) {}
+
+VOID Path::Clear()
+{
+  m_Words.clear();
+  m_Length = 0;
+  m_Found = false;
+}
+
+VOID Path::Reset(Position start)
+{
+  m_Words.clear();
+  m_Length = 0;
+  m_Start = start;
+  m_End = start;
+  m_Found = true;
+}
+
+VOID Path::Push(BYTE direction)
+{
+  auto shift = MOVE_BITS * (m_Length % MOVES_PER_WORD);
+  if (!shift) m_Words.push_back(0);
+
+  m_Words.back() |= static_cast<DWORD64>(direction) << shift;
+  m_Length++;
+
+  m_End.X = static_cast<WORD>(m_End.X + DIRECTION_DX[direction]);
+  m_End.Y = static_cast<WORD>(m_End.Y + DIRECTION_DY[direction]);
+}
+
+VOID Path::Reserve(size_t moves)
+{
+  m_Words.reserve((moves + MOVES_PER_WORD - 1) / MOVES_PER_WORD);
+}
+
+VOID Path::GetWaypoints(std::vector<Position>& waypoints) const
+{
+  waypoints.clear();
+
+  if (!m_Found) return;
+
+  waypoints.push_back(m_Start);
+
+  // cell before move which differs from previous one is a turn
+  auto position = m_Start;
+
+  for (size_t i = 0; i < m_Length; i++)
+  {
+    auto move = GetMove(i);
+
+    if (i && move != GetMove(i - 1))
+    {
+      waypoints.push_back(position);
+    }
+
+    position.X = static_cast<WORD>(position.X + DIRECTION_DX[move]);
+    position.Y = static_cast<WORD>(position.Y + DIRECTION_DY[move]);
+  }
+
+  if (m_Length) waypoints.push_back(m_End);
+}
+
+BYTE Path::GetDirection(INT dx, INT dy)
+{
+  BYTE direction = 0;
+  while (direction < NEIGHBOURS_COUNT - 1 && (DIRECTION_DX[direction] != dx || DIRECTION_DY[direction] != dy))
+  {
+    direction++;
+  }
+
+  return direction;
+}
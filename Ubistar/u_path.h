@@ -0,0 +1,192 @@
+#pragma once
+
+/*!
+ *  \brief     Compact path
+ *  \details   Start cell and moves packed by 3 bits, the way search
+ *             returns found path to callers
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_world.h"
+#include "u_expand.h"
+
+#include <Windows.h>
+#include <vector>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Path as start cell plus moves in DIRECTIONS order, 21 moves are packed
+  *  into one 64 bit word. Cells are restored by iterating, only turns are
+  *  kept by waypoint conversion. Memory of moves is kept between paths
+  */
+  class Path
+  {
+  public:
+
+    /*!
+    *  Iterates cells of the path from start to end
+    */
+    class Iterator
+    {
+    public:
+
+      /*!
+      *  ctor with path and index of cell (0 is start)
+      */
+      Iterator(const Path* path, size_t index, Position position)
+        : m_Path(path), m_Index(index), m_Position(position) {}
+
+      /*!
+      *  \return current cell
+      */
+      const Position& operator*() const { return m_Position; }
+
+      /*!
+      *  steps to the next cell
+      */
+      Iterator& operator++();
+
+      BOOL operator==(const Iterator& other) const { return m_Index == other.m_Index; }
+      BOOL operator!=(const Iterator& other) const { return m_Index != other.m_Index; }
+
+    private:
+
+      //
+      // iterated path
+      //
+      const Path* m_Path;
+
+      //
+      // index of current cell and its position
+      //
+      size_t m_Index;
+      Position m_Position;
+    };
+
+    /*!
+    *  default ctor, path is not found
+    */
+    Path();
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~Path() = default;
+
+    /*!
+    *  Forgets moves, path becomes not found
+    */
+    VOID Clear();
+
+    /*!
+    *  Forgets moves, path becomes found one which has only start
+    *  \param start first cell
+    */
+    VOID Reset(Position start);
+
+    /*!
+    *  Appends move
+    *  \param direction index in DIRECTIONS
+    */
+    VOID Push(BYTE direction);
+
+    /*!
+    *  Makes room for moves, so pushing them does not allocate
+    *  \param moves amount of moves
+    */
+    VOID Reserve(size_t moves);
+
+    /*!
+    *  \return true if path is found
+    */
+    BOOL IsFound() const { return m_Found; }
+
+    /*!
+    *  \return true if path is found, so path can be checked like before
+    */
+    explicit operator bool() const { return m_Found; }
+
+    /*!
+    *  \return first and last cells
+    */
+    Position GetStart() const { return m_Start; }
+    Position GetEnd() const { return m_End; }
+
+    /*!
+    *  \return amount of moves
+    */
+    size_t GetMovesCount() const { return m_Length; }
+
+    /*!
+    *  \return amount of cells, start and end included (0 if not found)
+    */
+    size_t GetCellsCount() const { return m_Found ? m_Length + 1 : 0; }
+
+    /*!
+    *  \param index of move, below GetMovesCount
+    *  \return index in DIRECTIONS
+    */
+    BYTE GetMove(size_t index) const
+    {
+      return static_cast<BYTE>((m_Words[index / MOVES_PER_WORD] >> (MOVE_BITS * (index % MOVES_PER_WORD))) & MOVE_MASK);
+    }
+
+    /*!
+    *  \return iterators over cells
+    */
+    Iterator begin() const { return Iterator(this, 0, m_Start); }
+    Iterator end() const { return Iterator(this, GetCellsCount(), m_End); }
+
+    /*!
+    *  Cells where path turns, start and end included
+    *  \param waypoints output, cleared first
+    */
+    VOID GetWaypoints(std::vector<Position>& waypoints) const;
+
+    /*!
+    *  \return size of moves in bytes
+    */
+    size_t GetSize() const { return m_Words.size() * sizeof(DWORD64); }
+
+    /*!
+    *  \return index in DIRECTIONS of step by dx and dy (both from -1 to 1, not both 0)
+    */
+    static BYTE GetDirection(INT dx, INT dy);
+
+  private:
+
+    //
+    // packing of moves into words
+    //
+    static constexpr DWORD MOVE_BITS = 3;
+    static constexpr DWORD64 MOVE_MASK = (1 << MOVE_BITS) - 1;
+    static constexpr size_t MOVES_PER_WORD = 64 / MOVE_BITS;
+
+    //
+    // first and last cells
+    //
+    Position m_Start;
+    Position m_End;
+
+    //
+    // packed moves, words above m_Length are kept for next paths
+    //
+    std::vector<DWORD64> m_Words;
+    size_t m_Length;
+
+    //
+    // status
+    //
+    BOOL m_Found;
+  };
+}
@@ -0,0 +1,112 @@
+/*!
+ *  \brief     Search phase profiler impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_profile.h"
+#include "u_alloc.h"
+
+#include <algorithm>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  PhaseProfiler class impl
+ ***********************************************/
+
+PhaseProfiler::PhaseProfiler()
+  : m_Cycles(), m_Nanoseconds(), m_Allocations(), m_Entries(), m_Current(SEARCH_PHASE::COUNT),
+  m_StartCycles(0), m_StartAllocations(0), m_Queries(0) {}
+
+VOID PhaseProfiler::Enter(SEARCH_PHASE phase)
+{
+  Close();
+
+  m_Current = phase;
+  m_StartAllocations = GetAllocationsCount();
+
+  // time is taken last, so it does not include reading cycles
+  QueryThreadCycleTime(GetCurrentThread(), &m_StartCycles);
+  m_StartTime = high_resolution_clock::now();
+}
+
+VOID PhaseProfiler::EndQuery()
+{
+  Close();
+  m_Queries++;
+}
+
+VOID PhaseProfiler::Reset()
+{
+  fill(begin(m_Cycles), end(m_Cycles), 0);
+  fill(begin(m_Nanoseconds), end(m_Nanoseconds), 0);
+  fill(begin(m_Allocations), end(m_Allocations), 0);
+  fill(begin(m_Entries), end(m_Entries), 0);
+
+  m_Current = SEARCH_PHASE::COUNT;
+  m_Queries = 0;
+}
+
+VOID PhaseProfiler::Close()
+{
+  if (m_Current == SEARCH_PHASE::COUNT) return;
+
+  // time is taken first, same order as in Enter but reversed
+  auto time = high_resolution_clock::now();
+
+  ULONG64 cycles;
+  QueryThreadCycleTime(GetCurrentThread(), &cycles);
+
+  auto phase = static_cast<BYTE>(m_Current);
+  m_Cycles[phase] += cycles - m_StartCycles;
+  m_Nanoseconds[phase] += duration_cast<nanoseconds>(time - m_StartTime).count();
+  m_Allocations[phase] += GetAllocationsCount() - m_StartAllocations;
+  m_Entries[phase]++;
+
+  m_Current = SEARCH_PHASE::COUNT;
+}
+
+const CHAR* PhaseProfiler::GetPhaseName(SEARCH_PHASE phase)
+{
+  switch (phase)
+  {
+  case SEARCH_PHASE::RESET:
+    return "reset";
+  case SEARCH_PHASE::EXPANSION:
+    return "expansion";
+  case SEARCH_PHASE::TRACE:
+    return "trace";
+  default:
+    return "unknown";
+  }
+}
+
+VOID PhaseProfiler::Print(std::ostream& out, const CHAR* prefix) const
+{
+  DWORD64 total = 0;
+  for (auto cycles : m_Cycles) total += cycles;
+
+  auto queries = max<size_t>(m_Queries, 1);
+
+  for (BYTE phase = 0; phase < PHASES_COUNT; phase++)
+  {
+    out << prefix << GetPhaseName(static_cast<SEARCH_PHASE>(phase))
+      << " queries=" << m_Queries
+      << " entries=" << m_Entries[phase]
+      << " cycles_per_query=" << m_Cycles[phase] / queries
+      << " ms_per_query=" << GetDuration(static_cast<SEARCH_PHASE>(phase)) / queries
+      << " allocations_per_query=" << static_cast<DOUBLE>(m_Allocations[phase]) / queries
+      << " cycles_share=" << (total ? (100.0 * m_Cycles[phase]) / total : 0) << "%" << '\n';
+  }
+}
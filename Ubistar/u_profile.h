@@ -0,0 +1,158 @@
+#pragma once
+
+/*!
+ *  \brief     Search phase profiler
+ *  \details   Thread cycles, time and heap allocations of each phase
+ *             of search, summed over batch of queries
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include <Windows.h>
+#include <chrono>
+#include <ostream>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Phases every search goes through
+  */
+  enum class SEARCH_PHASE
+  {
+    //
+    // search state and world marks are reset
+    //
+    RESET,
+
+    //
+    // open list loop
+    //
+    EXPANSION,
+
+    //
+    // path is traced back from end
+    //
+    TRACE,
+
+    //
+    // not a phase, amount of them
+    //
+    COUNT
+  };
+
+  /*!
+  *  Sums per phase: cycles of calling thread (QueryThreadCycleTime, so time
+  *  when thread was switched out is not counted), wall time, heap allocations
+  *  of calling thread and entries.
+  *  Searcher switches phases, only one phase is open at a time.
+  *  Not thread safe, it is used from one thread only
+  */
+  class PhaseProfiler
+  {
+  public:
+
+    /*!
+    *  amount of phases
+    */
+    static constexpr BYTE PHASES_COUNT = static_cast<BYTE>(SEARCH_PHASE::COUNT);
+
+    /*!
+    *  default ctor, it initializes all to 0
+    */
+    PhaseProfiler();
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~PhaseProfiler() = default;
+
+    /*!
+    *  closes open phase and opens given one
+    *  \param phase phase to open
+    */
+    VOID Enter(SEARCH_PHASE phase);
+
+    /*!
+    *  closes open phase and counts one query
+    */
+    VOID EndQuery();
+
+    /*!
+    *  forgets all sums
+    */
+    VOID Reset();
+
+    /*!
+    *  \return amount of counted queries
+    */
+    size_t GetQueries() const { return m_Queries; }
+
+    /*!
+    *  \param phase phase
+    *  \return thread cycles spent in phase
+    */
+    DWORD64 GetCycles(SEARCH_PHASE phase) const { return m_Cycles[static_cast<BYTE>(phase)]; }
+
+    /*!
+    *  \param phase phase
+    *  \return milliseconds spent in phase
+    */
+    DOUBLE GetDuration(SEARCH_PHASE phase) const { return m_Nanoseconds[static_cast<BYTE>(phase)] / 1000000.0; }
+
+    /*!
+    *  \param phase phase
+    *  \return heap allocations made in phase
+    */
+    size_t GetAllocations(SEARCH_PHASE phase) const { return m_Allocations[static_cast<BYTE>(phase)]; }
+
+    /*!
+    *  \param phase phase
+    *  \return text name of phase
+    */
+    static const CHAR* GetPhaseName(SEARCH_PHASE phase);
+
+    /*!
+    *  prints one line per phase: cycles, time and allocations per query
+    *  and share of cycles
+    *  \param out stream to print to
+    *  \param prefix text each line starts with
+    */
+    VOID Print(std::ostream& out, const CHAR* prefix) const;
+
+  private:
+
+    /*!
+    *  adds cycles, time and allocations since phase was opened to its sums
+    */
+    VOID Close();
+
+    //
+    // sums per phase
+    //
+    DWORD64 m_Cycles[PHASES_COUNT];
+    DWORD64 m_Nanoseconds[PHASES_COUNT];
+    size_t m_Allocations[PHASES_COUNT];
+    size_t m_Entries[PHASES_COUNT];
+
+    //
+    // open phase and where it started
+    //
+    SEARCH_PHASE m_Current;
+    ULONG64 m_StartCycles;
+    size_t m_StartAllocations;
+    std::chrono::high_resolution_clock::time_point m_StartTime;
+
+    //
+    // amount of queries
+    //
+    size_t m_Queries;
+  };
+}
@@ -0,0 +1,243 @@
+/*!
+ *  \brief     Shared map registry impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_registry.h"
+
+#include <cstring>
+#include <stdexcept>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// first bytes of map segment
+constexpr CHAR SHARED_MAP_MAGIC[4] = { 'U', 'B', 'S', 'M' };
+
+// costs start at cache line after header
+constexpr DWORD SHARED_COSTS_OFFSET = 64;
+
+// publisher may replace version while we attach, then the newer one is tried
+constexpr BYTE ATTACH_ATTEMPTS = 8;
+
+static_assert(sizeof(SharedMapHeader) <= SHARED_COSTS_OFFSET, "header overlaps costs");
+static_assert(atomic<DWORD>::is_always_lock_free, "version must be lock free to be shared");
+
+/************************************************
+ *  SharedMap class impl
+ ***********************************************/
+
+SharedMap::SharedMap(const std::string& name)
+  : m_Name(name), m_DirectoryHandle(nullptr), m_Directory(nullptr),
+  m_SegmentHandle(nullptr), m_Header(nullptr), m_Costs(nullptr),
+  m_Layout(CELL_LAYOUT::ROW_MAJOR, 1, 1)
+{
+  m_DirectoryHandle = OpenFileMapping(FILE_MAP_READ, FALSE, GetSharedMapObjectName(name, 0).c_str());
+
+  if (m_DirectoryHandle)
+  {
+    m_Directory = static_cast<const SharedMapDirectory*>(
+      MapViewOfFile(m_DirectoryHandle, FILE_MAP_READ, 0, 0, sizeof(SharedMapDirectory)));
+  }
+
+  for (BYTE attempt = 0; m_Directory && attempt < ATTACH_ATTEMPTS; attempt++)
+  {
+    auto version = m_Directory->Version.load(memory_order_acquire);
+
+    if (!version) break;
+    if (Open(version)) return;
+  }
+
+  // dtor is not called for object which ctor throws
+  Close();
+  throw runtime_error("map is not published");
+}
+
+SharedMap::~SharedMap()
+{
+  Close();
+}
+
+BOOL SharedMap::Open(DWORD version)
+{
+  m_SegmentHandle = OpenFileMapping(FILE_MAP_READ, FALSE, GetSharedMapObjectName(m_Name, version).c_str());
+  if (!m_SegmentHandle) return false;
+
+  m_Header = static_cast<const SharedMapHeader*>(MapViewOfFile(m_SegmentHandle, FILE_MAP_READ, 0, 0, 0));
+
+  // segment of the name may come from other program or be broken,
+  // header is trusted only as far as the view goes
+  MEMORY_BASIC_INFORMATION info = {};
+  size_t viewSize = m_Header && VirtualQuery(m_Header, &info, sizeof(info)) ? info.RegionSize : 0;
+
+  BOOL valid = viewSize >= sizeof(SharedMapHeader) &&
+    !memcmp(m_Header->Magic, SHARED_MAP_MAGIC, sizeof(SHARED_MAP_MAGIC)) && m_Header->Version == version &&
+    m_Header->CostsOffset >= sizeof(SharedMapHeader) && m_Header->CostsOffset <= viewSize &&
+    m_Header->CostsCount <= (viewSize - m_Header->CostsOffset) / sizeof(FLOAT) &&
+    m_Header->Layout <= static_cast<DWORD>(CELL_LAYOUT::TILED) &&
+    m_Header->Cols && m_Header->Rows;
+
+  // every cell of the grid has to be in the view
+  if (valid)
+  {
+    m_Layout = CellLayout(static_cast<CELL_LAYOUT>(m_Header->Layout), static_cast<size_t>(m_Header->Cols) + 2,
+      static_cast<size_t>(m_Header->Rows) + 2);
+    valid = m_Layout.GetSize() <= m_Header->CostsCount;
+  }
+
+  if (!valid)
+  {
+    if (m_Header) UnmapViewOfFile(m_Header);
+    CloseHandle(m_SegmentHandle);
+
+    m_Header = nullptr;
+    m_SegmentHandle = nullptr;
+
+    return false;
+  }
+
+  m_Costs = reinterpret_cast<const FLOAT*>(reinterpret_cast<const BYTE*>(m_Header) + m_Header->CostsOffset);
+
+  return true;
+}
+
+VOID SharedMap::Close()
+{
+  if (m_Header) UnmapViewOfFile(m_Header);
+  if (m_SegmentHandle) CloseHandle(m_SegmentHandle);
+  if (m_Directory) UnmapViewOfFile(m_Directory);
+  if (m_DirectoryHandle) CloseHandle(m_DirectoryHandle);
+
+  m_Header = nullptr;
+  m_Costs = nullptr;
+  m_SegmentHandle = nullptr;
+  m_Directory = nullptr;
+  m_DirectoryHandle = nullptr;
+}
+
+/************************************************
+ *  MapRegistry class impl
+ ***********************************************/
+
+MapRegistry::~MapRegistry()
+{
+  for (auto& [name, published] : m_Published)
+  {
+    UnmapViewOfFile(published.Directory);
+    CloseHandle(published.DirectoryHandle);
+    CloseHandle(published.SegmentHandle);
+  }
+}
+
+DWORD MapRegistry::Publish(const std::string& name, const World& world)
+{
+  auto found = m_Published.find(name);
+
+  if (found == m_Published.end())
+  {
+    // new mapping is zero filled, that is version 0 - nothing published yet
+    auto handle = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+      0, sizeof(SharedMapDirectory), GetSharedMapObjectName(name, 0).c_str());
+
+    if (!handle)
+    {
+      throw runtime_error("shared memory can not be created");
+    }
+
+    // directory is there only if other process publishes the same name
+    if (GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+      CloseHandle(handle);
+      throw runtime_error("map is published by other process");
+    }
+
+    auto directory = static_cast<SharedMapDirectory*>(
+      MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedMapDirectory)));
+
+    if (!directory)
+    {
+      CloseHandle(handle);
+      throw runtime_error("shared memory can not be mapped");
+    }
+
+    found = m_Published.insert({ name, { handle, directory, nullptr } }).first;
+  }
+
+  auto& published = found->second;
+  auto version = published.Directory->Version.load(memory_order_acquire) + 1;
+
+  auto costsSize = world.GetPaddedSize() * sizeof(FLOAT);
+  auto size = static_cast<DWORD64>(SHARED_COSTS_OFFSET) + costsSize;
+
+  auto handle = CreateFileMapping(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+    static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), GetSharedMapObjectName(name, version).c_str());
+
+  if (!handle)
+  {
+    throw runtime_error("shared memory can not be created");
+  }
+
+  // same version is there only if other process publishes the same name
+  if (GetLastError() == ERROR_ALREADY_EXISTS)
+  {
+    CloseHandle(handle);
+    throw runtime_error("map is published by other process");
+  }
+
+  auto view = static_cast<BYTE*>(MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, 0));
+
+  if (!view)
+  {
+    CloseHandle(handle);
+    throw runtime_error("shared memory can not be mapped");
+  }
+
+  SharedMapHeader header = {};
+  memcpy(header.Magic, SHARED_MAP_MAGIC, sizeof(SHARED_MAP_MAGIC));
+  header.Version = version;
+  header.Cols = static_cast<DWORD>(world.GetCols());
+  header.Rows = static_cast<DWORD>(world.GetRows());
+  header.Layout = static_cast<DWORD>(world.GetLayout().GetType());
+  header.CostsOffset = SHARED_COSTS_OFFSET;
+  header.CostsCount = world.GetPaddedSize();
+
+  memcpy(view, &header, sizeof(header));
+  memcpy(view + SHARED_COSTS_OFFSET, world.GetPaddedCosts(), costsSize);
+
+  // handle keeps segment, view of publisher is not needed
+  UnmapViewOfFile(view);
+
+  // segment is complete, only now readers may see it
+  published.Directory->Version.store(version, memory_order_release);
+
+  if (published.SegmentHandle) CloseHandle(published.SegmentHandle);
+  published.SegmentHandle = handle;
+
+  return version;
+}
+
+/************************************************
+ *  Functions impl
+ ***********************************************/
+
+std::basic_string<TCHAR> ubistar::GetSharedMapObjectName(const std::string& name, DWORD version)
+{
+  // session local namespace, no privilege is needed to create objects there
+  auto objectName = "Local\\ubistar.map." + name;
+  if (version) objectName += "." + to_string(version);
+
+  return basic_string<TCHAR>(objectName.begin(), objectName.end());
+}
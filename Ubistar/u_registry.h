@@ -0,0 +1,202 @@
+#pragma once
+
+/*!
+ *  \brief     Shared map registry
+ *  \details   Terrain costs of loaded maps published into named shared
+ *             memory, other processes attach to them without copying
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_world.h"
+#include "u_layout.h"
+
+#include <Windows.h>
+#include <tchar.h>
+#include <atomic>
+#include <string>
+#include <unordered_map>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Directory segment of one map name, it only says which version is current.
+  *  Atomic without lock does not depend on address, so it works across processes
+  */
+  struct SharedMapDirectory
+  {
+    std::atomic<DWORD> Version;
+  };
+
+  /*!
+  *  Header of map segment, padded costs of World go right after it
+  */
+  struct SharedMapHeader
+  {
+    CHAR Magic[4];
+    DWORD Version;
+    DWORD Cols;
+    DWORD Rows;
+    DWORD Layout;
+    DWORD CostsOffset;
+    DWORD64 CostsCount;
+  };
+
+  /*!
+  *  One version of map attached read only, costs are used right
+  *  from shared memory, so attaching copies nothing
+  */
+  class SharedMap
+  {
+  public:
+
+    /*!
+    *  ctor, attaches to the current version of map
+    *  \param name name map was published with
+    *
+    *  \details throws runtime_error if map is not published
+    */
+    SharedMap(const std::string& name);
+
+    /*!
+    *  dtor, views and handles are closed, segment lives while anyone keeps it
+    */
+    ~SharedMap();
+
+    SharedMap(const SharedMap&) = delete;
+    SharedMap& operator=(const SharedMap&) = delete;
+
+    /*!
+    *  \return false if newer version was published after attaching
+    */
+    BOOL IsCurrent() const { return m_Directory->Version.load(std::memory_order_acquire) == m_Header->Version; }
+
+    /*!
+    *  \return name and version of attached map
+    */
+    const std::string& GetName() const { return m_Name; }
+    DWORD GetVersion() const { return m_Header->Version; }
+
+    /*!
+    *  \return map size
+    */
+    size_t GetCols() const { return m_Header->Cols; }
+    size_t GetRows() const { return m_Header->Rows; }
+
+    /*!
+    *  same grid as World::GetPaddedCosts, it lives in shared memory
+    *  \return pointer to first element
+    */
+    const FLOAT* GetPaddedCosts() const { return m_Costs; }
+
+    /*!
+    *  \return amount of cells in padded grid
+    */
+    size_t GetPaddedSize() const { return static_cast<size_t>(m_Header->CostsCount); }
+
+    /*!
+    *  \return layout of padded grid
+    */
+    const CellLayout& GetLayout() const { return m_Layout; }
+
+  private:
+
+    /*!
+    *  maps segment of given version
+    *  \return false if there is no such segment (it was replaced already)
+    */
+    BOOL Open(DWORD version);
+
+    /*!
+    *  closes segment view and handle
+    */
+    VOID Close();
+
+    //
+    // name of map
+    //
+    std::string m_Name;
+
+    //
+    // directory of the name
+    //
+    HANDLE m_DirectoryHandle;
+    const SharedMapDirectory* m_Directory;
+
+    //
+    // attached version
+    //
+    HANDLE m_SegmentHandle;
+    const SharedMapHeader* m_Header;
+    const FLOAT* m_Costs;
+    CellLayout m_Layout;
+  };
+
+  /*!
+  *  Publisher side. Each publish of the name writes a new segment and only
+  *  then switches current version, so attached processes never see a map
+  *  half written, they move to new version between queries. Old segment is
+  *  freed by system once its last process detaches
+  */
+  class MapRegistry
+  {
+  public:
+
+    /*!
+    *  default ctor, nothing is published yet
+    */
+    MapRegistry() = default;
+
+    /*!
+    *  dtor, published maps disappear once attached processes detach
+    */
+    ~MapRegistry();
+
+    MapRegistry(const MapRegistry&) = delete;
+    MapRegistry& operator=(const MapRegistry&) = delete;
+
+    /*!
+    *  Publishes costs of world as the next version of map
+    *  \param name name of map, other processes attach by it
+    *  \param world loaded world, it is not kept
+    *  \return published version, first one is 1
+    *
+    *  \details only terrain costs are shared, indexes derived from them
+    *           (contraction hierarchy, path database, subgoal graph) are not.
+    *           Throws runtime_error if shared memory can not be created
+    */
+    DWORD Publish(const std::string& name, const World& world);
+
+  private:
+
+    /*!
+    *  Handles publisher keeps, so segments stay alive
+    */
+    struct Published
+    {
+      HANDLE DirectoryHandle;
+      SharedMapDirectory* Directory;
+      HANDLE SegmentHandle;
+    };
+
+    //
+    // published maps by name
+    //
+    std::unordered_map<std::string, Published> m_Published;
+  };
+
+  /*!
+  *  \param name name of map
+  *  \param version version of map, 0 for directory of the name
+  *  \return name of shared memory object
+  */
+  std::basic_string<TCHAR> GetSharedMapObjectName(const std::string& name, DWORD version);
+}
@@ -0,0 +1,470 @@
+/*!
+ *  \brief     Query server impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_server.h"
+
+#include <shlwapi.h>
+#include <chrono>
+#include <iostream>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// default size of text maps
+constexpr WORD DEFAULT_MAP_COLS = 126;
+constexpr WORD DEFAULT_MAP_ROWS = 126;
+
+// tiles kept in memory for chunked maps
+constexpr size_t SERVER_CACHE_TILES = 64;
+
+/************************************************
+ *  Server class impl
+ ***********************************************/
+
+Server::Server(std::istream& in, std::ostream& out)
+  : m_In(in), m_Out(out), m_Profiling(false)
+{
+  // only known commands get histogram
+  for (auto command : { "load", "publish", "attach", "unload", "path", "nearest", "costs", "stats", "profile" })
+  {
+    m_Latency[command];
+    m_Allocations[command] = 0;
+  }
+
+  for (auto command : { "path", "nearest", "costs" })
+  {
+    m_SearchAllocations[command] = 0;
+  }
+}
+
+int Server::Run()
+{
+  string line;
+
+  while (getline(m_In, line))
+  {
+    auto start = high_resolution_clock::now();
+    auto allocations = GetAllocationsCount();
+
+    istringstream request(line);
+    string command;
+    request >> command;
+
+    if (command.empty()) continue;
+
+    BOOL proceed = true;
+
+    try
+    {
+      if (command == "load") proceed = HandleLoad(request);
+      else if (command == "publish") proceed = HandlePublish(request);
+      else if (command == "attach") proceed = HandleAttach(request);
+      else if (command == "unload") proceed = HandleUnload(request);
+      else if (command == "path") proceed = HandlePath(request);
+      else if (command == "nearest") proceed = HandleGoals(request, true);
+      else if (command == "costs") proceed = HandleGoals(request, false);
+      else if (command == "stats") proceed = HandleStats(request);
+      else if (command == "profile") proceed = HandleProfile(request);
+      else if (command == "quit")
+      {
+        m_Out << "ok quit" << '\n';
+        proceed = false;
+      }
+      else
+      {
+        throw runtime_error("unknown command");
+      }
+    }
+    catch (exception& e)
+    {
+      m_Out << "error " << e.what() << '\n';
+    }
+
+    auto histogram = m_Latency.find(command);
+    if (histogram != m_Latency.end())
+    {
+      auto end = high_resolution_clock::now();
+      histogram->second.Add(duration_cast<microseconds>(end - start).count() / 1000.0);
+      m_Allocations[command] += GetAllocationsCount() - allocations;
+    }
+
+    if (!proceed) break;
+
+    // nothing more is queued, deliver responses before waiting for input
+    if (m_In.rdbuf()->in_avail() <= 0)
+    {
+      m_Out.flush();
+    }
+  }
+
+  m_Out.flush();
+
+  return 0;
+}
+
+std::basic_string<TCHAR> Server::ReadMapRequest(std::istringstream& request, std::string& name, size_t& cols, size_t& rows)
+{
+  string path;
+  cols = DEFAULT_MAP_COLS;
+  rows = DEFAULT_MAP_ROWS;
+
+  if (!(request >> name >> path))
+  {
+    throw runtime_error("wrong arguments");
+  }
+
+  string size[2];
+  string rest;
+  request >> size[0] >> size[1];
+
+  // size is given by both values or not at all, nothing may follow it
+  if (size[0].empty() != size[1].empty() || request >> rest)
+  {
+    throw runtime_error("wrong arguments");
+  }
+
+  if (!size[0].empty())
+  {
+    LONGLONG values[2] = {};
+
+    for (BYTE i = 0; i < 2; i++)
+    {
+      istringstream value(size[i]);
+
+      if (!(value >> values[i]) || !value.eof())
+      {
+        throw runtime_error("wrong arguments");
+      }
+    }
+
+    // one tile border is added around the map, it still has to fit in WORD
+    if (values[0] <= 0 || values[1] <= 0 || values[0] > MAXWORD - 2 || values[1] > MAXWORD - 2)
+    {
+      throw runtime_error("map size is out of range");
+    }
+
+    cols = static_cast<size_t>(values[0]);
+    rows = static_cast<size_t>(values[1]);
+  }
+
+  // protocol is ascii, so path is widened as is
+  basic_string<TCHAR> mapPath(path.begin(), path.end());
+
+  if (!PathFileExists(mapPath.c_str()))
+  {
+    throw runtime_error("path to map file is wrong");
+  }
+
+  return mapPath;
+}
+
+VOID Server::CheckMapSize(const std::basic_string<TCHAR>& mapPath, size_t cols, size_t rows)
+{
+  size_t fileCols = 0;
+  size_t fileRows = 0;
+
+  if (!World::ReadFileSize(mapPath, fileCols, fileRows) || fileCols != cols || fileRows != rows)
+  {
+    throw runtime_error("map size does not match the file");
+  }
+}
+
+BOOL Server::HandleLoad(std::istringstream& request)
+{
+  string name;
+  size_t cols, rows;
+  auto mapPath = ReadMapRequest(request, name, cols, rows);
+
+  unique_ptr<AStar> pathFinder;
+  auto chunked = make_unique<ChunkedWorld>(mapPath, SERVER_CACHE_TILES);
+
+  if (chunked->IsValid())
+  {
+    pathFinder = make_unique<AStar>(move(chunked));
+  }
+  else
+  {
+    CheckMapSize(mapPath, cols, rows);
+    pathFinder = make_unique<AStar>(mapPath, static_cast<WORD>(rows), static_cast<WORD>(cols), false);
+  }
+
+  pathFinder->SetProfiler(GetProfiler());
+
+  m_Out << "ok load " << name << " " << pathFinder->GetMapCols() << " " << pathFinder->GetMapRows() << '\n';
+  m_Maps[name] = move(pathFinder);
+
+  return true;
+}
+
+BOOL Server::HandlePublish(std::istringstream& request)
+{
+  string name;
+  size_t cols, rows;
+  auto mapPath = ReadMapRequest(request, name, cols, rows);
+
+  CheckMapSize(mapPath, cols, rows);
+
+  // world is needed only to be copied into shared memory
+  DWORD version;
+  {
+    World world(mapPath, rows, cols);
+    version = m_Registry.Publish(name, world);
+  }
+
+  // publisher searches in shared copy too, same as everyone else
+  auto pathFinder = make_unique<AStar>(make_unique<SharedMap>(name));
+  pathFinder->SetProfiler(GetProfiler());
+
+  m_Out << "ok publish " << name << " " << version
+    << " " << pathFinder->GetMapCols() << " " << pathFinder->GetMapRows() << '\n';
+  m_Maps[name] = move(pathFinder);
+
+  return true;
+}
+
+BOOL Server::HandleAttach(std::istringstream& request)
+{
+  string name;
+
+  if (!(request >> name))
+  {
+    throw runtime_error("wrong arguments");
+  }
+
+  auto pathFinder = make_unique<AStar>(make_unique<SharedMap>(name));
+  pathFinder->SetProfiler(GetProfiler());
+  auto shared = pathFinder->GetSharedMap();
+
+  m_Out << "ok attach " << name << " " << shared->GetVersion()
+    << " " << pathFinder->GetMapCols() << " " << pathFinder->GetMapRows() << '\n';
+  m_Maps[name] = move(pathFinder);
+
+  return true;
+}
+
+BOOL Server::HandleUnload(std::istringstream& request)
+{
+  string name;
+
+  if (!(request >> name) || !m_Maps.erase(name))
+  {
+    throw runtime_error("unknown map");
+  }
+
+  m_Out << "ok unload " << name << '\n';
+
+  return true;
+}
+
+BOOL Server::HandlePath(std::istringstream& request)
+{
+  string name;
+  size_t startX, startY, endX, endY;
+
+  if (!(request >> name >> startX >> startY >> endX >> endY))
+  {
+    throw runtime_error("wrong arguments");
+  }
+
+  auto pathFinder = FindMap(name);
+  auto cols = pathFinder->GetMapCols();
+  auto rows = pathFinder->GetMapRows();
+
+  if (startX >= cols || endX >= cols || startY >= rows || endY >= rows)
+  {
+    throw runtime_error("input coordinate is out of range");
+  }
+
+  pathFinder->FindPath(static_cast<WORD>(startX), static_cast<WORD>(startY),
+    static_cast<WORD>(endX), static_cast<WORD>(endY));
+
+  m_SearchAllocations["path"] += pathFinder->GetLastAllocations();
+
+  m_Out << "ok path " << (pathFinder->IsLastFound() ? "true" : "false")
+    << " " << pathFinder->GetLastCost()
+    << " " << pathFinder->GetLastExpansions()
+    << " " << pathFinder->GetLastDuration() << '\n';
+
+  return true;
+}
+
+AStar* Server::FindMap(const std::string& name)
+{
+  auto found = m_Maps.find(name);
+  if (found == m_Maps.end())
+  {
+    throw runtime_error("unknown map");
+  }
+
+  // old version stays mapped until here, so query never sees map being replaced
+  auto shared = found->second->GetSharedMap();
+  if (shared && !shared->IsCurrent())
+  {
+    found->second = make_unique<AStar>(make_unique<SharedMap>(name));
+    found->second->SetProfiler(GetProfiler());
+  }
+
+  return found->second.get();
+}
+
+AStar* Server::ReadGoalsRequest(std::istringstream& request, Position& start, std::vector<Position>& goals)
+{
+  string name;
+  size_t x, y;
+
+  if (!(request >> name >> x >> y))
+  {
+    throw runtime_error("wrong arguments");
+  }
+
+  auto pathFinder = FindMap(name);
+  auto cols = pathFinder->GetMapCols();
+  auto rows = pathFinder->GetMapRows();
+
+  if (x >= cols || y >= rows)
+  {
+    throw runtime_error("input coordinate is out of range");
+  }
+
+  start = { static_cast<WORD>(x), static_cast<WORD>(y) };
+
+  while (request >> x >> y)
+  {
+    if (x >= cols || y >= rows)
+    {
+      throw runtime_error("input coordinate is out of range");
+    }
+
+    goals.push_back({ static_cast<WORD>(x), static_cast<WORD>(y) });
+  }
+
+  if (goals.empty())
+  {
+    throw runtime_error("no goals");
+  }
+
+  return pathFinder;
+}
+
+BOOL Server::HandleGoals(std::istringstream& request, BOOL nearest)
+{
+  Position start;
+  vector<Position> goals;
+  auto pathFinder = ReadGoalsRequest(request, start, goals);
+
+  if (nearest)
+  {
+    pathFinder->FindNearestGoal(start.X, start.Y, goals);
+    m_SearchAllocations["nearest"] += pathFinder->GetLastAllocations();
+
+    m_Out << "ok nearest " << (pathFinder->IsLastFound() ? "true" : "false")
+      << " " << pathFinder->GetLastGoal()
+      << " " << pathFinder->GetLastCost()
+      << " " << pathFinder->GetLastExpansions()
+      << " " << pathFinder->GetLastDuration() << '\n';
+  }
+  else
+  {
+    pathFinder->FindCostsToGoals(start.X, start.Y, goals);
+    m_SearchAllocations["costs"] += pathFinder->GetLastAllocations();
+
+    m_Out << "ok costs " << pathFinder->GetLastExpansions()
+      << " " << pathFinder->GetLastDuration();
+
+    for (auto cost : pathFinder->GetLastGoalCosts())
+    {
+      m_Out << " " << cost;
+    }
+
+    m_Out << '\n';
+  }
+
+  return true;
+}
+
+BOOL Server::HandleStats(std::istringstream&)
+{
+  m_Out << "ok stats " << m_Latency.size() + 2 + PhaseProfiler::PHASES_COUNT << '\n';
+
+  for (const auto& [command, histogram] : m_Latency)
+  {
+    m_Out << command << " ";
+    histogram.Print(m_Out);
+    m_Out << '\n';
+  }
+
+  // stats request itself is counted once it is answered
+  size_t total = 0;
+  for (const auto& [command, count] : m_Allocations) total += count;
+
+  m_Out << "allocations total=" << total;
+  for (const auto& [command, count] : m_Allocations) m_Out << " " << command << "=" << count;
+  m_Out << '\n';
+
+  // searches alone, parsing and formatting of requests is not counted
+  total = 0;
+  for (const auto& [command, count] : m_SearchAllocations) total += count;
+
+  m_Out << "search_allocations total=" << total;
+  for (const auto& [command, count] : m_SearchAllocations) m_Out << " " << command << "=" << count;
+  m_Out << '\n';
+
+  m_Profiler.Print(m_Out, "phase ");
+
+  return true;
+}
+
+BOOL Server::HandleProfile(std::istringstream& request)
+{
+  string mode;
+
+  if (!(request >> mode) || (mode != "on" && mode != "off"))
+  {
+    throw runtime_error("wrong arguments");
+  }
+
+  // reading cycles and clock twice per phase is not free, so it is opt-in
+  m_Profiling = mode == "on";
+
+  for (auto& [name, pathFinder] : m_Maps) pathFinder->SetProfiler(GetProfiler());
+
+  m_Out << "ok profile " << mode << '\n';
+
+  return true;
+}
+
+/************************************************
+ *  Functions impl
+ ***********************************************/
+
+int ubistar::RunServer(const int& argc, TCHAR* argv[])
+{
+  if (argc != 2)
+  {
+    cerr << "Amount of input args are wrong" << endl;
+    return ERROR_INVALID_DATA;
+  }
+
+  // reading must not flush every response, server flushes itself
+  ios::sync_with_stdio(false);
+  cin.tie(nullptr);
+
+  Server server(cin, cout);
+  return server.Run();
+}
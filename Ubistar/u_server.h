@@ -0,0 +1,190 @@
+#pragma once
+
+/*!
+ *  \brief     Query server
+ *  \details   Long running mode, maps stay loaded between queries
+ *             which come as text lines
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_astar.h"
+#include "u_stats.h"
+#include "u_alloc.h"
+#include "u_registry.h"
+
+#include <Windows.h>
+#include <tchar.h>
+#include <string>
+#include <memory>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <map>
+#include <vector>
+#include <unordered_map>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Line protocol server, one request per line, one response per request,
+  *  responses go in the same order as requests, so client may send
+  *  many requests without waiting (pipelining)
+  *
+  *  load <name> <path> [cols rows]   -> ok load <name> <cols> <rows>
+  *  publish <name> <path> [cols rows]
+  *                                   -> ok publish <name> <version> <cols> <rows>
+  *  attach <name>                    -> ok attach <name> <version> <cols> <rows>
+  *  unload <name>                    -> ok unload <name>
+  *  path <name> <sx> <sy> <ex> <ey>  -> ok path <found> <cost> <expansions> <ms>
+  *  nearest <name> <sx> <sy> <x1> <y1> [<x2> <y2> ...]
+  *                                   -> ok nearest <found> <goal> <cost> <expansions> <ms>
+  *  costs <name> <sx> <sy> <x1> <y1> [<x2> <y2> ...]
+  *                                   -> ok costs <expansions> <ms> <cost1> <cost2> ...
+  *  stats                            -> ok stats <n>, then n lines <command> <histogram>,
+  *                                      allocations, search_allocations
+  *                                      and phase <phase> <sums> per search phase
+  *  profile <on|off>                 -> ok profile <on|off>
+  *  quit                             -> ok quit
+  *
+  *  Any failure is answered by: error <message>
+  *  Chunked maps (see convert mode) are recognised by their header.
+  *  Published map lives in shared memory while publishing server runs, other
+  *  servers attach to it without own copy. Publishing the name again makes
+  *  new version, attached servers switch to it before their next query.
+  *  Phases are summed only while profile is on, it is off at start
+  */
+  class Server
+  {
+  public:
+
+    /*!
+    *  ctor with streams to talk over
+    *  \param in requests
+    *  \param out responses
+    */
+    Server(std::istream& in, std::ostream& out);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~Server() = default;
+
+    /*!
+    *  Serves requests until quit or end of input
+    *  \return 0 in success, or error code
+    */
+    int Run();
+
+  private:
+
+    /*!
+    *  Handlers of commands, request holds args left after command name
+    *  \return false if server has to stop
+    */
+    BOOL HandleLoad(std::istringstream& request);
+    BOOL HandlePublish(std::istringstream& request);
+    BOOL HandleAttach(std::istringstream& request);
+    BOOL HandleUnload(std::istringstream& request);
+    BOOL HandlePath(std::istringstream& request);
+    BOOL HandleStats(std::istringstream& request);
+    BOOL HandleProfile(std::istringstream& request);
+    BOOL HandleGoals(std::istringstream& request, BOOL nearest);
+
+    /*!
+    *  Reads args of load and publish requests
+    *  \param request args of request
+    *  \param name name of map
+    *  \param cols amount of cols of text map
+    *  \param rows amount of rows of text map
+    *  \return path to existing map file
+    */
+    std::basic_string<TCHAR> ReadMapRequest(std::istringstream& request, std::string& name, size_t& cols, size_t& rows);
+
+    /*!
+    *  Checks that text map has this size, World reads symbols one by one,
+    *  so other size would crop the map or wrap its rows wrongly
+    *  \param mapPath path to text map
+    *  \param cols amount of cols of request
+    *  \param rows amount of rows of request
+    *
+    *  \details throws runtime_error if size does not match
+    */
+    static VOID CheckMapSize(const std::basic_string<TCHAR>& mapPath, size_t cols, size_t rows);
+
+    /*!
+    *  Finds loaded map, attached one is switched to its newest version first
+    *  \param name name of map
+    *  \return map to search in
+    */
+    AStar* FindMap(const std::string& name);
+
+    /*!
+    *  Reads map name, start and goals of multi goal request
+    *  \param request args of request
+    *  \param start start position
+    *  \param goals goals, at least one
+    *  \return map to search in
+    */
+    AStar* ReadGoalsRequest(std::istringstream& request, Position& start, std::vector<Position>& goals);
+
+    /*!
+    *  \return profiler maps have to report to, nullptr if profiling is off
+    */
+    PhaseProfiler* GetProfiler() { return m_Profiling ? &m_Profiler : nullptr; }
+
+    //
+    // streams to talk over
+    //
+    std::istream& m_In;
+    std::ostream& m_Out;
+
+    //
+    // loaded maps by name
+    //
+    std::unordered_map<std::string, std::unique_ptr<AStar>> m_Maps;
+
+    //
+    // maps this server published
+    //
+    MapRegistry m_Registry;
+
+    //
+    // request latency by command name
+    //
+    std::map<std::string, LatencyHistogram> m_Latency;
+
+    //
+    // heap allocations made by requests by command name
+    //
+    std::map<std::string, size_t> m_Allocations;
+
+    //
+    // heap allocations made by searches alone by command name
+    //
+    std::map<std::string, size_t> m_SearchAllocations;
+
+    //
+    // search phases of all maps, summed only while profiling is on
+    //
+    PhaseProfiler m_Profiler;
+    BOOL m_Profiling;
+  };
+
+  /*!
+  *  Server mode over stdin and stdout
+  *  \param argc equals to 2
+  *  \param argv contains the following pattern:
+  *              astar.exe serve
+  *  \return 0 in success, or error code
+  */
+  int RunServer(const int& argc, TCHAR* argv[]);
+}
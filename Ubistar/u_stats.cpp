@@ -0,0 +1,83 @@
+/*!
+ *  \brief     Query statistics impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_stats.h"
+
+#include <algorithm>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+
+/************************************************
+ *  LatencyHistogram class impl
+ ***********************************************/
+
+LatencyHistogram::LatencyHistogram()
+  : m_Buckets(), m_Count(0), m_Sum(0), m_Max(0) {}
+
+VOID LatencyHistogram::Add(DOUBLE milliseconds)
+{
+  auto microseconds = static_cast<DWORD64>(max(milliseconds, 0.0) * 1000.0);
+
+  // first bucket which upper bound is above the value
+  BYTE bucket = 0;
+  while (bucket < BUCKETS_COUNT - 1 && (1ull << bucket) <= microseconds)
+  {
+    bucket++;
+  }
+
+  m_Buckets[bucket]++;
+  m_Count++;
+  m_Sum += milliseconds;
+  m_Max = max(m_Max, milliseconds);
+}
+
+DWORD64 LatencyHistogram::GetPercentile(DOUBLE percent) const
+{
+  auto target = static_cast<size_t>((m_Count * percent) / 100.0);
+  size_t seen = 0;
+
+  for (BYTE bucket = 0; bucket < BUCKETS_COUNT; bucket++)
+  {
+    seen += m_Buckets[bucket];
+
+    if (seen > target || (seen == m_Count && seen))
+    {
+      return 1ull << bucket;
+    }
+  }
+
+  return 0;
+}
+
+VOID LatencyHistogram::Print(std::ostream& out) const
+{
+  out << "count=" << m_Count
+    << " mean_ms=" << GetMean()
+    << " max_ms=" << m_Max
+    << " p50_us<" << GetPercentile(50)
+    << " p90_us<" << GetPercentile(90)
+    << " p99_us<" << GetPercentile(99)
+    << " buckets_us=";
+
+  BOOL first = true;
+
+  for (BYTE bucket = 0; bucket < BUCKETS_COUNT; bucket++)
+  {
+    if (!m_Buckets[bucket]) continue;
+
+    out << (first ? "" : ",") << "<" << (1ull << bucket) << ":" << m_Buckets[bucket];
+    first = false;
+  }
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+/*!
+ *  \brief     Query statistics
+ *  \details   Latency histogram with power of two buckets
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include <Windows.h>
+#include <ostream>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Histogram of durations, bucket i keeps values below 2^i microseconds
+  */
+  class LatencyHistogram
+  {
+  public:
+
+    /*!
+    *  amount of buckets, last one keeps everything above ~35 minutes
+    */
+    static constexpr BYTE BUCKETS_COUNT = 32;
+
+    /*!
+    *  default ctor, it initializes all to 0
+    */
+    LatencyHistogram();
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~LatencyHistogram() = default;
+
+    /*!
+    *  counts one more duration
+    *  \param milliseconds duration
+    */
+    VOID Add(DOUBLE milliseconds);
+
+    /*!
+    *  \return amount of counted durations
+    */
+    size_t GetCount() const { return m_Count; }
+
+    /*!
+    *  \return average duration in milliseconds
+    */
+    DOUBLE GetMean() const { return m_Count ? m_Sum / m_Count : 0; }
+
+    /*!
+    *  \return longest duration in milliseconds
+    */
+    DOUBLE GetMax() const { return m_Max; }
+
+    /*!
+    *  \param percent from 0 to 100
+    *  \return upper bound (in microseconds) of bucket where percentile falls
+    */
+    DWORD64 GetPercentile(DOUBLE percent) const;
+
+    /*!
+    *  prints one line: count, mean, percentiles and non empty buckets
+    *  \param out stream to print to
+    */
+    VOID Print(std::ostream& out) const;
+
+  private:
+
+    //
+    // amount of durations per bucket
+    //
+    size_t m_Buckets[BUCKETS_COUNT];
+
+    //
+    // totals
+    //
+    size_t m_Count;
+    DOUBLE m_Sum;
+    DOUBLE m_Max;
+  };
+}
@@ -0,0 +1,454 @@
+/*!
+ *  \brief     Subgoal graph impl
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_subgoal.h"
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+  /************************************************
+   *  Namespaces
+   ***********************************************/
+
+using namespace ubistar;
+using namespace std;
+using namespace chrono;
+
+/************************************************
+ *  Shortcuts & global constants
+ ***********************************************/
+
+// cell is not a subgoal, or no cell at all
+constexpr DWORD NONE = MAXDWORD;
+
+// distance of cells search did not reach yet
+constexpr FLOAT UNREACHED = numeric_limits<FLOAT>::max();
+
+// both local searches of a query
+constexpr BYTE FORWARD = 0;
+constexpr BYTE BACKWARD = 1;
+
+// just to shorten, min heap of graph search by f
+using GraphItem = pair<FLOAT, DWORD>;
+
+/************************************************
+ *  SubgoalGraph class impl
+ ***********************************************/
+
+SubgoalGraph::SubgoalGraph(const World& world)
+  : m_Cols(world.GetCols()), m_Rows(world.GetRows()), m_MinCost(numeric_limits<FLOAT>::max()),
+  m_Cost(0), m_Duration(0), m_BuildDuration(0), m_Expansions(0)
+{
+  auto start = high_resolution_clock::now();
+
+  auto cells = m_Cols * m_Rows;
+  const auto* costs = world.GetPaddedCosts();
+
+  m_Costs.resize(cells);
+
+  for (size_t y = 0; y < m_Rows; y++)
+  {
+    for (size_t x = 0; x < m_Cols; x++)
+    {
+      auto cost = costs[world.GetPaddedIndex(static_cast<WORD>(x), static_cast<WORD>(y))];
+      m_Costs[y * m_Cols + x] = cost;
+
+      if (cost > 0.0f) m_MinCost = min(m_MinCost, cost);
+    }
+  }
+
+  // cells out of the map are blocked
+  auto costAt = [this](INT x, INT y) -> FLOAT
+  {
+    if (x < 0 || y < 0 || x >= static_cast<INT>(m_Cols) || y >= static_cast<INT>(m_Rows)) return 0.0f;
+    return m_Costs[y * m_Cols + x];
+  };
+
+  m_SubgoalByCell.resize(cells, NONE);
+
+  for (INT y = 0; y < static_cast<INT>(m_Rows); y++)
+  {
+    for (INT x = 0; x < static_cast<INT>(m_Cols); x++)
+    {
+      auto cost = costAt(x, y);
+      if (cost <= 0.0f) continue;
+
+      BOOL subgoal = false;
+
+      for (BYTE i = 0; i < NEIGHBOURS_COUNT && !subgoal; i++)
+      {
+        auto dx = DIRECTION_DX[i];
+        auto dy = DIRECTION_DY[i];
+        auto neighbour = costAt(x + dx, y + dy);
+
+        // paths bend around convex corner of water right here
+        if (i >= 4 && neighbour <= 0.0f && costAt(x + dx, y) > 0.0f && costAt(x, y + dy) > 0.0f)
+        {
+          subgoal = true;
+        }
+
+        // cheaper side of terrain border is enough, leaving
+        // more expensive terrain steps on it anyway
+        if (neighbour > cost)
+        {
+          subgoal = true;
+        }
+      }
+
+      if (!subgoal) continue;
+
+      m_SubgoalByCell[y * m_Cols + x] = static_cast<DWORD>(m_Subgoals.size());
+      m_Subgoals.push_back(static_cast<DWORD>(y * m_Cols + x));
+    }
+  }
+
+  for (BYTE direction : { FORWARD, BACKWARD })
+  {
+    m_Dist[direction].resize(cells, UNREACHED);
+    m_Parent[direction].resize(cells, NONE);
+    m_Covered[direction].resize(cells, false);
+  }
+
+  m_Offsets.resize(m_Subgoals.size() + 1);
+
+  for (DWORD subgoal = 0; subgoal < m_Subgoals.size(); subgoal++)
+  {
+    m_Offsets[subgoal] = static_cast<DWORD>(m_Edges.size());
+
+    auto source = m_Subgoals[subgoal];
+    Explore(source, FORWARD, NONE);
+
+    // moves of edge are kept, so found path is not searched again
+    for (const auto& [cell, cost] : m_Reached)
+    {
+      m_Edges.push_back({ m_SubgoalByCell[cell], cost, static_cast<DWORD>(m_Moves.size()) });
+
+      auto first = m_Moves.size();
+      for (auto current = cell; current != source; current = m_Parent[FORWARD][current])
+      {
+        m_Moves.push_back(GetDirection(m_Parent[FORWARD][current], current));
+      }
+
+      reverse(m_Moves.begin() + first, m_Moves.end());
+    }
+  }
+
+  m_Offsets[m_Subgoals.size()] = static_cast<DWORD>(m_Edges.size());
+
+  // start and end are extra nodes
+  auto nodes = m_Subgoals.size() + 2;
+
+  m_G.resize(nodes, UNREACHED);
+  m_GraphParent.resize(nodes, NONE);
+  m_GraphEdge.resize(nodes, NONE);
+  m_Closed.resize(nodes, false);
+  m_ToEnd.resize(m_Subgoals.size(), UNREACHED);
+
+  auto end = high_resolution_clock::now();
+  m_BuildDuration = duration_cast<microseconds>(end - start).count() / 1000.0;
+}
+
+VOID SubgoalGraph::Explore(DWORD source, BYTE direction, DWORD stop)
+{
+  const auto diagonal = sqrtf(2.0f);
+
+  auto& dist = m_Dist[direction];
+  auto& parent = m_Parent[direction];
+  auto& coveredCells = m_Covered[direction];
+  auto& touched = m_Touched[direction];
+
+  for (auto cell : touched) dist[cell] = UNREACHED;
+  touched.clear();
+  m_Heap.clear();
+  m_Reached.clear();
+
+  dist[source] = 0;
+  parent[source] = NONE;
+  coveredCells[source] = false;
+  touched.push_back(source);
+  m_Heap.push_back({ 0.0f, source, false });
+
+  // entries of paths which did not pass a subgoal yet, when none is left
+  // every subgoal found later is covered anyway
+  size_t uncovered = 1;
+
+  while (!m_Heap.empty() && uncovered)
+  {
+    pop_heap(m_Heap.begin(), m_Heap.end(), greater<HeapItem>());
+    auto item = m_Heap.back();
+    m_Heap.pop_back();
+
+    if (!item.Covered) uncovered--;
+    if (item.Dist > dist[item.Cell]) continue;
+
+    auto cell = item.Cell;
+    auto current = item.Dist;
+
+    m_Expansions++;
+
+    BOOL subgoal = cell != source && m_SubgoalByCell[cell] != NONE;
+
+    if (cell != source && (subgoal || cell == stop) && !coveredCells[cell])
+    {
+      m_Reached.push_back({ cell, current });
+    }
+
+    // path which goes on from subgoal is covered by edges of that subgoal
+    BOOL covered = coveredCells[cell] || subgoal;
+
+    INT x = static_cast<INT>(cell % m_Cols);
+    INT y = static_cast<INT>(cell / m_Cols);
+
+    for (BYTE i = 0; i < NEIGHBOURS_COUNT; i++)
+    {
+      INT nx = x + DIRECTION_DX[i];
+      INT ny = y + DIRECTION_DY[i];
+
+      if (nx < 0 || ny < 0 || nx >= static_cast<INT>(m_Cols) || ny >= static_cast<INT>(m_Rows)) continue;
+
+      auto neighbour = static_cast<DWORD>(ny * m_Cols + nx);
+      if (m_Costs[neighbour] <= 0.0f) continue;
+
+      // step costs as the cell stepped on, going backward it is the cell we come from
+      auto cost = direction == BACKWARD ? m_Costs[cell] : m_Costs[neighbour];
+      auto next = current + cost * (i < 4 ? 1.0f : diagonal);
+
+      // equal path through subgoal is preferred, so fewer edges are kept
+      if (next == dist[neighbour] && covered && !coveredCells[neighbour])
+      {
+        coveredCells[neighbour] = true;
+        parent[neighbour] = cell;
+        continue;
+      }
+
+      if (next >= dist[neighbour]) continue;
+
+      if (dist[neighbour] == UNREACHED) touched.push_back(neighbour);
+      dist[neighbour] = next;
+      parent[neighbour] = cell;
+      coveredCells[neighbour] = covered;
+
+      if (!covered) uncovered++;
+      m_Heap.push_back({ next, neighbour, covered });
+      push_heap(m_Heap.begin(), m_Heap.end(), greater<HeapItem>());
+    }
+  }
+}
+
+BYTE SubgoalGraph::GetDirection(DWORD from, DWORD to) const
+{
+  auto dx = static_cast<INT>(to % m_Cols) - static_cast<INT>(from % m_Cols);
+  auto dy = static_cast<INT>(to / m_Cols) - static_cast<INT>(from / m_Cols);
+
+  BYTE direction = 0;
+  while (DIRECTION_DX[direction] != dx || DIRECTION_DY[direction] != dy) direction++;
+
+  return direction;
+}
+
+VOID SubgoalGraph::AppendCell(DWORD cell)
+{
+  m_Path.push_back({ static_cast<WORD>(cell % m_Cols), static_cast<WORD>(cell / m_Cols) });
+}
+
+FLOAT SubgoalGraph::CalcH(DWORD from, DWORD to) const
+{
+  // octile distance over the cheapest terrain
+  auto dx = abs(static_cast<INT>(from % m_Cols) - static_cast<INT>(to % m_Cols));
+  auto dy = abs(static_cast<INT>(from / m_Cols) - static_cast<INT>(to / m_Cols));
+
+  auto straight = static_cast<FLOAT>(max(dx, dy) - min(dx, dy));
+  auto diagonal = static_cast<FLOAT>(min(dx, dy));
+
+  return m_MinCost * (straight + diagonal * sqrtf(2.0f));
+}
+
+BOOL SubgoalGraph::FindPath(WORD startX, WORD startY, WORD endX, WORD endY)
+{
+  auto start = high_resolution_clock::now();
+
+  m_Cost = 0;
+  m_Expansions = 0;
+  m_Path.clear();
+
+  auto source = static_cast<DWORD>(startY * m_Cols + startX);
+  auto target = static_cast<DWORD>(endY * m_Cols + endX);
+
+  auto subgoals = static_cast<DWORD>(m_Subgoals.size());
+  const DWORD START = subgoals;
+  const DWORD END = subgoals + 1;
+
+  for (auto node : m_GraphTouched)
+  {
+    m_G[node] = UNREACHED;
+    m_Closed[node] = false;
+    if (node < subgoals) m_ToEnd[node] = UNREACHED;
+  }
+  m_GraphTouched.clear();
+
+  BOOL found = false;
+
+  if (m_Costs[source] > 0.0f && m_Costs[target] > 0.0f)
+  {
+    // start is connected to subgoals it reaches directly, end may be among them
+    Explore(source, FORWARD, target);
+
+    m_StartEdges.clear();
+    FLOAT direct = UNREACHED;
+
+    for (const auto& [cell, cost] : m_Reached)
+    {
+      if (cell == target) direct = cost;
+      else m_StartEdges.push_back({ m_SubgoalByCell[cell], cost, NONE });
+    }
+
+    if (source == target) direct = 0;
+
+    // subgoals which reach end directly, found going backward from it
+    Explore(target, BACKWARD, NONE);
+
+    for (const auto& [cell, cost] : m_Reached)
+    {
+      auto subgoal = m_SubgoalByCell[cell];
+      m_ToEnd[subgoal] = cost;
+      m_GraphTouched.push_back(subgoal);
+    }
+
+    if (m_SubgoalByCell[target] != NONE)
+    {
+      m_ToEnd[m_SubgoalByCell[target]] = 0;
+      m_GraphTouched.push_back(m_SubgoalByCell[target]);
+    }
+
+    // direct path is the first candidate, graph search only beats it
+    m_G[START] = 0;
+    m_G[END] = direct;
+    m_GraphParent[END] = direct != UNREACHED ? START : NONE;
+    m_GraphTouched.push_back(START);
+    m_GraphTouched.push_back(END);
+
+    auto& heap = m_GraphHeap;
+    heap.clear();
+    heap.push_back({ CalcH(source, target), START });
+
+    auto relax = [&](DWORD from, DWORD to, FLOAT cost, DWORD edge)
+    {
+      auto g = m_G[from] + cost;
+      if (m_Closed[to] || g >= m_G[to]) return;
+
+      if (m_G[to] == UNREACHED) m_GraphTouched.push_back(to);
+      m_G[to] = g;
+      m_GraphParent[to] = from;
+      m_GraphEdge[to] = edge;
+
+      auto h = to == END ? 0.0f : CalcH(m_Subgoals[to], target);
+      heap.push_back({ g + h, to });
+      push_heap(heap.begin(), heap.end(), greater<GraphItem>());
+    };
+
+    while (!heap.empty())
+    {
+      pop_heap(heap.begin(), heap.end(), greater<GraphItem>());
+      auto [f, node] = heap.back();
+      heap.pop_back();
+
+      // heuristic never overestimates, so nothing left may beat current end
+      if (f >= m_G[END]) break;
+      if (m_Closed[node]) continue;
+
+      m_Closed[node] = true;
+      m_Expansions++;
+
+      if (node == START)
+      {
+        for (const auto& edge : m_StartEdges) relax(START, edge.Subgoal, edge.Cost, NONE);
+        continue;
+      }
+
+      for (auto i = m_Offsets[node]; i < m_Offsets[node + 1]; i++)
+      {
+        relax(node, m_Edges[i].Subgoal, m_Edges[i].Cost, i);
+      }
+
+      if (m_ToEnd[node] != UNREACHED) relax(node, END, m_ToEnd[node], NONE);
+    }
+
+    found = m_G[END] != UNREACHED;
+  }
+
+  if (found)
+  {
+    m_Route.clear();
+    for (auto node = END; node != START; node = m_GraphParent[node])
+    {
+      m_Route.push_back(node);
+    }
+
+    reverse(m_Route.begin(), m_Route.end());
+
+    AppendCell(source);
+
+    for (auto node : m_Route)
+    {
+      auto from = m_GraphParent[node];
+
+      if (from == START)
+      {
+        // start side is what forward search left, its parents lead back to start
+        auto first = m_Path.size();
+        auto cell = node == END ? target : m_Subgoals[node];
+
+        for (; cell != source; cell = m_Parent[FORWARD][cell]) AppendCell(cell);
+
+        reverse(m_Path.begin() + first, m_Path.end());
+      }
+      else if (node == END)
+      {
+        // end side is what backward search left, its parents lead on to end
+        for (auto cell = m_Subgoals[from]; cell != target; ) AppendCell(cell = m_Parent[BACKWARD][cell]);
+      }
+      else
+      {
+        auto edge = m_GraphEdge[node];
+        auto last = edge + 1 < m_Edges.size() ? m_Edges[edge + 1].Moves : static_cast<DWORD>(m_Moves.size());
+
+        for (auto i = m_Edges[edge].Moves; i < last; i++)
+        {
+          const auto& previous = m_Path.back();
+          m_Path.push_back({ static_cast<WORD>(previous.X + DIRECTION_DX[m_Moves[i]]),
+            static_cast<WORD>(previous.Y + DIRECTION_DY[m_Moves[i]]) });
+        }
+      }
+    }
+
+    // exact cost is summed over cells
+    const auto diagonal = sqrt(2.0);
+
+    for (size_t i = 1; i < m_Path.size(); i++)
+    {
+      BOOL straight = m_Path[i].X == m_Path[i - 1].X || m_Path[i].Y == m_Path[i - 1].Y;
+      m_Cost += m_Costs[m_Path[i].Y * m_Cols + m_Path[i].X] * (straight ? 1.0 : diagonal);
+    }
+  }
+
+  auto end = high_resolution_clock::now();
+  m_Duration = duration_cast<microseconds>(end - start).count() / 1000.0;
+
+  return found;
+}
+
+size_t SubgoalGraph::GetSize() const
+{
+  return m_Edges.size() * sizeof(Edge) + m_Moves.size() * sizeof(BYTE)
+    + (m_Offsets.size() + m_Subgoals.size() + m_SubgoalByCell.size()) * sizeof(DWORD);
+}
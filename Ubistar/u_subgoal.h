@@ -0,0 +1,209 @@
+#pragma once
+
+/*!
+ *  \brief     Subgoal graph
+ *  \details   Abstraction of World over water corners and terrain borders
+ *  \author    Daulet Tumbayev
+ *  \date      2021
+ */
+
+ /************************************************
+  *  Includes
+  ***********************************************/
+
+#include "u_world.h"
+
+#include <Windows.h>
+#include <vector>
+#include <utility>
+
+  /************************************************
+   *  class decl
+   ***********************************************/
+
+namespace ubistar
+{
+  /*!
+  *  Subgoals are cells next to convex water corners and cells which touch
+  *  more expensive terrain. Subgoal gets an edge with exact cost to every
+  *  subgoal it reaches cheapest without passing other subgoals. Any shortest
+  *  path splits at subgoals it passes into such edges, so search over the
+  *  graph gives exact cost, cells of the path are restored from moves kept per edge
+  */
+  class SubgoalGraph
+  {
+  public:
+
+    /*!
+    *  ctor, subgoals and edges are built here
+    *  \param world world to build graph for, it is not kept
+    */
+    SubgoalGraph(const World& world);
+
+    /*!
+    *  default dtor, no need to free anything in this class by hand
+    */
+    ~SubgoalGraph() = default;
+
+    /*!
+    *  Point to point query
+    *  \param startX x coordinate (col) of start pos
+    *  \param startY y coordinate (row) of start pos
+    *  \param endX x coordinate (col) of end pos
+    *  \param endY y coordinate (row) of end pos
+    *  \return true if path is found
+    */
+    BOOL FindPath(WORD startX, WORD startY, WORD endX, WORD endY);
+
+    /*!
+    *  \return cost of the path found by last FindPath (0 if not found)
+    */
+    DOUBLE GetLastCost() const { return m_Cost; }
+
+    /*!
+    *  \return cells of the path found by last FindPath, start and end included
+    */
+    const std::vector<Position>& GetLastPath() const { return m_Path; }
+
+    /*!
+    *  \return duration of last FindPath in milliseconds
+    */
+    DOUBLE GetLastDuration() const { return m_Duration; }
+
+    /*!
+    *  \return cells settled by local searches plus subgoals expanded by last FindPath
+    */
+    size_t GetLastExpansions() const { return m_Expansions; }
+
+    /*!
+    *  \return build duration in milliseconds
+    */
+    DOUBLE GetBuildDuration() const { return m_BuildDuration; }
+
+    /*!
+    *  \return amount of subgoals
+    */
+    size_t GetSubgoalsCount() const { return m_Subgoals.size(); }
+
+    /*!
+    *  \return amount of edges between subgoals
+    */
+    size_t GetEdgesCount() const { return m_Edges.size(); }
+
+    /*!
+    *  \return size of graph in bytes
+    */
+    size_t GetSize() const;
+
+  private:
+
+    /*!
+    *  Edge to subgoal with cost of the cheapest path which does not pass
+    *  other subgoals, moves of the path start at given offset
+    */
+    struct Edge
+    {
+      DWORD Subgoal;
+      FLOAT Cost;
+      DWORD Moves;
+    };
+
+    /*!
+    *  Cell in local search heap, covered if its path passed a subgoal
+    */
+    struct HeapItem
+    {
+      FLOAT Dist;
+      DWORD Cell;
+      BOOL Covered;
+
+      BOOL operator>(const HeapItem& other) const { return Dist > other.Dist; }
+    };
+
+    /*!
+    *  Dijkstra which goes on until every path left passed a subgoal,
+    *  subgoals no cheaper path through other subgoal reaches go to m_Reached
+    *  \param source cell to start from
+    *  \param direction 0 to go along edges, 1 to go against them (cost of
+    *                   cell stepped from), each direction keeps own state
+    *  \param stop cell which is reached as subgoal
+    */
+    VOID Explore(DWORD source, BYTE direction, DWORD stop);
+
+    /*!
+    *  \return direction of step between neighbour cells
+    */
+    BYTE GetDirection(DWORD from, DWORD to) const;
+
+    /*!
+    *  Appends cell to path found
+    */
+    VOID AppendCell(DWORD cell);
+
+    /*!
+    *  \return cost of the cheapest path between cells of free terrain
+    */
+    FLOAT CalcH(DWORD from, DWORD to) const;
+
+    //
+    // map size
+    //
+    size_t m_Cols;
+    size_t m_Rows;
+
+    //
+    // terrain cost per cell (y * cols + x) and the cheapest of them
+    //
+    std::vector<FLOAT> m_Costs;
+    FLOAT m_MinCost;
+
+    //
+    // subgoal per cell and cell per subgoal
+    //
+    std::vector<DWORD> m_SubgoalByCell;
+    std::vector<DWORD> m_Subgoals;
+
+    //
+    // edges from subgoals, CSR by subgoal
+    //
+    std::vector<DWORD> m_Offsets;
+    std::vector<Edge> m_Edges;
+
+    //
+    // moves of all edges one after another
+    //
+    std::vector<BYTE> m_Moves;
+
+    //
+    // local search state per direction, distances are reset only for touched cells
+    //
+    std::vector<FLOAT> m_Dist[2];
+    std::vector<DWORD> m_Parent[2];
+    std::vector<BYTE> m_Covered[2];
+    std::vector<DWORD> m_Touched[2];
+    std::vector<HeapItem> m_Heap;
+    std::vector<std::pair<DWORD, FLOAT>> m_Reached;
+
+    //
+    // graph search state, start and end are two extra nodes after subgoals
+    //
+    std::vector<FLOAT> m_G;
+    std::vector<DWORD> m_GraphParent;
+    std::vector<DWORD> m_GraphEdge;
+    std::vector<BYTE> m_Closed;
+    std::vector<FLOAT> m_ToEnd;
+    std::vector<DWORD> m_GraphTouched;
+    std::vector<std::pair<FLOAT, DWORD>> m_GraphHeap;
+    std::vector<Edge> m_StartEdges;
+
+    //
+    // results
+    //
+    DOUBLE m_Cost;
+    DOUBLE m_Duration;
+    DOUBLE m_BuildDuration;
+    size_t m_Expansions;
+    std::vector<Position> m_Path;
+    std::vector<DWORD> m_Route;
+  };
+}
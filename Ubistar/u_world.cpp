@@ -10,7 +10,9 @@
 
 #include "u_world.h"
 
+#include <tchar.h>
 #include <fstream>
+#include <algorithm>
 #include <iostream>
 
   /************************************************
@@ -36,13 +38,13 @@ FLOAT Coordinate::GetTotalCost() const
   return (m_g + m_h);
 }
 
-VOID Coordinate::SetData(BYTE x, BYTE y, TCHAR type)
+VOID Coordinate::SetData(WORD x, WORD y, TCHAR type)
 {
   SetCoords(x, y);
   SetTerrain(type);
 }
 
-VOID Coordinate::SetCoords(BYTE x, BYTE y)
+VOID Coordinate::SetCoords(WORD x, WORD y)
 {
   m_x = x;
   m_y = y;
@@ -108,21 +110,22 @@ VOID Coordinate::ResetValue()
  *  World class impl
  ***********************************************/
 
-World::World(std::basic_string<TCHAR> mapPath, size_t mapRows, size_t mapCols)
-  : m_MapRows(mapRows), m_MapCols(mapCols), m_Coordinates(mapRows * mapCols, Coordinate())
+World::World(std::basic_string<TCHAR> mapPath, size_t mapRows, size_t mapCols, CELL_LAYOUT layout)
+  : m_MapRows(mapRows), m_MapCols(mapCols), m_Layout(layout, mapCols + 2, mapRows + 2),
+  m_Coordinates(m_Layout.GetSize(), Coordinate())
 {
   // open file
   basic_fstream<TCHAR> infile(mapPath);
 
   // read it
-  BYTE currentX = 0;
-  BYTE currentY = 0;
+  WORD currentX = 0;
+  WORD currentY = 0;
   TCHAR symbol;
 
   while (infile >> symbol)
   {
     // match coordinates and indexes
-    m_Coordinates[(mapRows * currentY) + currentX].SetData(currentX, currentY, symbol);
+    GetCoord(currentX, currentY)->SetData(currentX, currentY, symbol);
     currentX++;
     if (currentX == mapCols)
     {
@@ -135,11 +138,44 @@ World::World(std::basic_string<TCHAR> mapPath, size_t mapRows, size_t mapCols)
       break;
     }
   }
+
+  // both containers share layout, border tiles are undefined
+  // and cost 0, it blocks same way as water
+  m_PaddedCosts.reserve(m_Coordinates.size());
+
+  for (const auto& coord : m_Coordinates)
+  {
+    m_PaddedCosts.push_back(coord.GetTerrainCost());
+  }
+}
+
+BOOL World::ReadFileSize(std::basic_string<TCHAR> mapPath, size_t& cols, size_t& rows)
+{
+  basic_ifstream<TCHAR> infile(mapPath);
+  if (!infile) return false;
+
+  basic_string<TCHAR> line;
+  cols = 0;
+  rows = 0;
+
+  while (getline(infile, line))
+  {
+    // whitespace is skipped by ctor as well, so it is not counted
+    auto symbols = static_cast<size_t>(count_if(line.begin(), line.end(), [](TCHAR symbol) { return !_istspace(symbol); }));
+    if (!symbols) continue;
+
+    if (rows && symbols != cols) return false;
+
+    cols = symbols;
+    rows++;
+  }
+
+  return rows > 0;
 }
 
-Coordinate* World::GetCoord(const BYTE& x, const BYTE& y)
+Coordinate* World::GetCoord(const WORD& x, const WORD& y)
 {
-  return &m_Coordinates[(static_cast<size_t>(m_MapRows) * y) + x];
+  return &m_Coordinates[GetPaddedIndex(x, y)];
 }
 
 Coordinate* World::GetNeighbour(const Coordinate* const current, DIRECTION direction)
@@ -207,15 +243,17 @@ Coordinate* World::GetNeighbour(const Coordinate* const current, DIRECTION direc
   break;
   }
 
+  auto neighbour = GetCoord(x, y);
+
   // no return if this neighbout is not valid
-  if (m_Coordinates[(m_MapRows * y) + x].GetTerrainType() == TERRAIN_TYPE::WATER ||
-    m_Coordinates[(m_MapRows * y) + x].GetTerrainType() == TERRAIN_TYPE::UNDEFINED ||
-    m_Coordinates[(m_MapRows * y) + x].IsChoosen())
+  if (neighbour->GetTerrainType() == TERRAIN_TYPE::WATER ||
+    neighbour->GetTerrainType() == TERRAIN_TYPE::UNDEFINED ||
+    neighbour->IsChoosen())
   {
     return nullptr;
   }
 
-  return &m_Coordinates[(m_MapRows * y) + x];
+  return neighbour;
 }
 
 VOID World::ResetValues()
@@ -228,13 +266,25 @@ VOID World::ResetValues()
 
 VOID World::Print()
 {
-  cout << endl;
-  for (size_t y = 0; y < m_MapRows; y++)
+  string text;
+  Render(text);
+
+  cout.write(text.data(), text.size());
+  cout.flush();
+}
+
+VOID World::Render(std::string& out)
+{
+  // empty line, then rows with line break each
+  out.reserve(out.size() + 1 + m_MapRows * (m_MapCols + 1));
+  out += '\n';
+
+  for (WORD y = 0; y < m_MapRows; y++)
   {
-    for (size_t x = 0; x < m_MapCols; x++)
+    for (WORD x = 0; x < m_MapCols; x++)
     {
-      cout << m_Coordinates[(m_MapRows * y) + x].GetTerrainTypeAsSym();
+      out += GetCoord(x, y)->GetTerrainTypeAsSym();
     }
-    cout << endl;
+    out += '\n';
   }
 }
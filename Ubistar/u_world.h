@@ -11,6 +11,8 @@
   *  Includes
   ***********************************************/
 
+#include "u_layout.h"
+
 #include <Windows.h>
 #include <tchar.h>
 #include <string>
@@ -63,6 +65,15 @@ namespace ubistar
     DIRECTION::WN
   };
 
+  /*!
+  *  Position of cell in map
+  */
+  struct Position
+  {
+    WORD X;
+    WORD Y;
+  };
+
   /*!
   *  One cell or tile in map
   */
@@ -83,8 +94,8 @@ namespace ubistar
     /*!
     *  simple getters
     */
-    BYTE GetX() const { return m_x; }
-    BYTE GetY() const { return m_y; }
+    WORD GetX() const { return m_x; }
+    WORD GetY() const { return m_y; }
     FLOAT GetG() const { return m_g; }
     FLOAT GetH() const { return m_h; }
     FLOAT GetTerrainCost() const { return m_TerrainCost; }
@@ -118,7 +129,7 @@ namespace ubistar
     /*!
     *  combining calls SetTerrain and SetCoords
     */
-    VOID SetData(BYTE x, BYTE y, TCHAR type);
+    VOID SetData(WORD x, WORD y, TCHAR type);
 
     /*!
     *  casting symbolic representation to enum
@@ -128,7 +139,7 @@ namespace ubistar
     /*!
     *  just setting x and y
     */
-    VOID SetCoords(BYTE x, BYTE y);
+    VOID SetCoords(WORD x, WORD y);
 
     /*!
     *  setting all back to 0
@@ -140,8 +151,8 @@ namespace ubistar
     //
     // coordinates
     //
-    BYTE m_x;
-    BYTE m_y;
+    WORD m_x;
+    WORD m_y;
 
     //
     // cost from point to start
@@ -201,22 +212,40 @@ namespace ubistar
     *  \param mapPath path to file
     *  \param mapRows max amount of rows
     *  \param mapCols max amoutn of cols
+    *  \param layout order of tiles in memory
     */
-    World(std::basic_string<TCHAR> mapPath, size_t mapRows, size_t mapCols);
+    World(std::basic_string<TCHAR> mapPath, size_t mapRows, size_t mapCols,
+      CELL_LAYOUT layout = CELL_LAYOUT::ROW_MAJOR);
 
     /*!
     *  default dtor, no need to free anything in this class by hand
     */
     ~World() = default;
 
+    /*!
+    *  Reads size of map file without loading it
+    *  \param mapPath path to file
+    *  \param cols output, amount of symbols per line
+    *  \param rows output, amount of lines with symbols
+    *  \return false if file can not be read or its lines differ in length
+    */
+    static BOOL ReadFileSize(std::basic_string<TCHAR> mapPath, size_t& cols, size_t& rows);
+
     /*!
     *  To get reference from container by coordinates
-    *  Note coordinates also match position in container
+    *  Note position in container depends on layout
     *  \param x col
     *  \param y row
     *  \return ref to tile
     */
-    Coordinate* GetCoord(const BYTE& x, const BYTE& y);
+    Coordinate* GetCoord(const WORD& x, const WORD& y);
+
+    /*!
+    *  To get reference from container by index in padded grid
+    *  \param index index given by GetPaddedIndex or layout
+    *  \return ref to tile
+    */
+    Coordinate* GetCoordByIndex(const size_t& index) { return &m_Coordinates[index]; }
 
     /*!
     *  To get reference from container. It goes for neighbour according to direction
@@ -226,16 +255,60 @@ namespace ubistar
     */
     Coordinate* GetNeighbour(const Coordinate* const current, DIRECTION direction);
 
+    /*!
+    *  Terrain costs copied into grid with 1 cell border of blocked cells
+    *  around the map, so neighbours can be read without bound checks.
+    *  Grid is ordered by the same layout as tiles
+    *  \return pointer to first element, 0 cost means cell can not be entered
+    */
+    const FLOAT* GetPaddedCosts() const { return m_PaddedCosts.data(); }
+
+    /*!
+    *  \return amount of cells in padded grid
+    */
+    size_t GetPaddedSize() const { return m_PaddedCosts.size(); }
+
+    /*!
+    *  \return layout of padded grid, map position (x, y) is (x + 1, y + 1) in it
+    */
+    const CellLayout& GetLayout() const { return m_Layout; }
+
+    /*!
+    *  \param x col
+    *  \param y row
+    *  \return index of the tile in padded grid
+    */
+    size_t GetPaddedIndex(const WORD& x, const WORD& y) const
+    {
+      return m_Layout.GetIndex(static_cast<size_t>(x) + 1, static_cast<size_t>(y) + 1);
+    }
+
+    /*!
+    *  \return max amount of cols (x)
+    */
+    size_t GetCols() const { return m_MapCols; }
+
+    /*!
+    *  \return max amount of rows (y)
+    */
+    size_t GetRows() const { return m_MapRows; }
+
     /*!
     *  Reset all tiles
     */
     VOID ResetValues();
 
     /*!
-    *  Print all tiles
+    *  Print all tiles by one write
     */
     VOID Print();
 
+    /*!
+    *  Appends all tiles as text, row per line
+    *  \param out text to append to
+    */
+    VOID Render(std::string& out);
+
   private:
 
     //
@@ -248,9 +321,19 @@ namespace ubistar
     //
     size_t m_MapCols;
 
+    //
+    // order of tiles in containers below, includes 1 tile border
+    //
+    CellLayout m_Layout;
+
     //
     // keeper of all tiles
     //
     std::vector<Coordinate> m_Coordinates;
+
+    //
+    // terrain costs with blocked border, filled once on load
+    //
+    std::vector<FLOAT> m_PaddedCosts;
   };
 }
\ No newline at end of file